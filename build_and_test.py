@@ -45,6 +45,7 @@ class Config:
 	cmake_defines: list[str] = field(default_factory=list) # Additional CMake definitions
 	list_only: bool = False # Flag to only list combinations without building
 	dry_run: bool = False # Flag to show commands without executing them
+	benchmark: str | None = None # Google Benchmark filter; the results are saved as JSON to the output directory
 	build_count: int = 0 # Counter for the number of builds performed
 	total: int = 0 # Total number of builds to perform
 
@@ -197,6 +198,8 @@ def configuring(build_dir: str, options: list[str]):
 	params += [f"-DCMAKE_BUILD_TYPE={config.build_config}"]
 	params += [f"-DVI_TM_OUTPUT_PATH={str(make_relative_if_subpath(config.path_to_result))}"]
 	params += options
+	if config.benchmark is not None:
+		params += ["-DVI_TM_ENABLE_BENCHMARK=ON"]
 	for val in config.cmake_defines:
 		params += [f"-D{val}"]
 	run(params)
@@ -231,6 +234,19 @@ def testing(build_dir: str):
 	run(params)
 	print("Test the project - done\n")
 
+def benchmarking(name: str):
+	"""Run the benchmarks of the freshly built test program and save the results as JSON."""
+	print(f"Benchmark the project {config.build_count}/{config.total}:")
+	# The output directory is shared by all combinations: take the test program that has just been built.
+	programs = sorted(pathlib.Path(config.path_to_result).glob("test_exe*"), key=lambda p: p.stat().st_mtime) if not config.dry_run else []
+	program = programs[-1] if programs else pathlib.Path(config.path_to_result) / "test_exe"
+	params = [str(make_relative_if_subpath(program))]
+	params += [f"--benchmark_filter={config.benchmark}"]
+	params += [f"--benchmark_out={make_relative_if_subpath(pathlib.Path(config.path_to_result) / ('benchmark_' + name + '.json'))}"]
+	params += ["--benchmark_out_format=json"]
+	run(params)
+	print("Benchmark the project - done\n")
+
 def work(options: list[str]):
 	"""Perform the full build and test cycle for a given set of options."""
 	start = datetime.datetime.now()
@@ -251,6 +267,8 @@ def work(options: list[str]):
 		configuring(build_dir, options)
 		build(build_dir)
 		testing(build_dir)
+		if config.benchmark is not None:
+			benchmarking(name)
 
 		folder_remake(build_dir, False)
 
@@ -281,6 +299,9 @@ def parse_args() -> Config:
 	parser.add_argument("-v", "--verbose", action="store_true", help="Verbose output")
 	parser.add_argument("--list-only", action="store_true", help="List all combinations without building")
 	parser.add_argument("--dry-run", action="store_true", help="Show commands without executing them")
+	parser.add_argument("--benchmark", type=str, nargs="?", const="BM_contention", metavar="<regex>", default=None,
+			help="Build with Google Benchmark, run the matching benchmarks and save them as JSON to the output directory. "
+			"E.g. 'rfat raf' compares the scaling curves of the thread-safe and non-thread-safe builds.")
 
 	args = parser.parse_args()
 
@@ -309,7 +330,8 @@ def parse_args() -> Config:
 		suffix_filters=filters,
 		cmake_defines=args.cmake_defines or [],
 		list_only=args.list_only,
-		dry_run=args.dry_run or args.list_only
+		dry_run=args.dry_run or args.list_only,
+		benchmark=args.benchmark
 	)
 	return result
 
@@ -13,6 +13,15 @@ function(vi_make_name_suffix OUT_VAR)
 	if(VI_TM_STAT_USE_MINMAX)
 		string(APPEND _flags "m")
 	endif()
+	if(VI_TM_STAT_USE_CPUTIME)
+		string(APPEND _flags "c")
+	endif()
+	if(VI_TM_STAT_USE_PERF)
+		string(APPEND _flags "p")
+	endif()
+	if(VI_TM_STAT_USE_RUSAGE)
+		string(APPEND _flags "u")
+	endif()
 	if(VI_TM_THREADSAFE)
 		string(APPEND _flags "t")
 	endif()
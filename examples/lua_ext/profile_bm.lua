@@ -0,0 +1,160 @@
+-- profile_bm.lua
+-- Overhead of the vi_timing Lua profiler (ProfileStart/ProfileStop): every workload runs without and with
+-- the profiler, and the difference is divided by the number of the profiled Lua calls. Calls of C functions
+-- are hooked too but not counted, so "ns per call" is shown only for the workloads made of Lua calls.
+-- Run it from the directory of the module.
+
+local suffix = (os.getenv("CONFIG") == "Debug") and "_d" or ""
+local function load_module()
+	for _, name in ipairs({ "./libvi_timing_lua", "./vi_timing_lua" }) do
+		for _, ext in ipairs({ ".so", ".dll", ".dylib" }) do
+			local open = package.loadlib(name .. suffix .. ext, "luaopen_vi_timing")
+			if open then
+				return open()
+			end
+		end
+	end
+	error("Cannot find the 'vi_timing_lua' module.")
+end
+
+local vt = load_module()
+
+-------------------------------------------------------------------------------
+-- Workloads: call-heavy, library-heavy and loop-heavy code.
+
+local function fib(n)
+	if n < 2 then return n end
+	return fib(n - 1) + fib(n - 2)
+end
+
+local function ackermann(m, n)
+	if m == 0 then return n + 1 end
+	if n == 0 then return ackermann(m - 1, 1) end
+	return ackermann(m - 1, ackermann(m, n - 1))
+end
+
+local function sort_closure()
+	local t = {}
+	local seed = 42
+	for i = 1, 20000 do
+		seed = (seed * 1103515245 + 12345) % 2147483648
+		t[i] = seed
+	end
+	table.sort(t, function(a, b) return a > b end)
+end
+
+local function strings()
+	local parts = {}
+	for i = 1, 20000 do
+		parts[#parts + 1] = string.format("%d:%s", i, string.rep("x", i % 7))
+	end
+	return (table.concat(parts, ","):gsub("x+", string.upper))
+end
+
+local function spectral_norm(n)
+	local function A(i, j)
+		local ij = i + j - 1
+		return 1.0 / (ij * (ij - 1) * 0.5 + i)
+	end
+	local function Av(x, y, N)
+		for i = 1, N do
+			local a = 0
+			for j = 1, N do a = a + x[j] * A(i, j) end
+			y[i] = a
+		end
+	end
+	local function Atv(x, y, N)
+		for i = 1, N do
+			local a = 0
+			for j = 1, N do a = a + x[j] * A(j, i) end
+			y[i] = a
+		end
+	end
+	local u, v, t = {}, {}, {}
+	for i = 1, n do u[i] = 1 end
+	for _ = 1, 10 do
+		Av(u, t, n) Atv(t, v, n)
+		Av(v, t, n) Atv(t, u, n)
+	end
+	local vBv, vv = 0, 0
+	for i = 1, n do
+		vBv = vBv + u[i] * v[i]
+		vv = vv + v[i] * v[i]
+	end
+	return math.sqrt(vBv / vv)
+end
+
+local function coroutines()
+	local gen = coroutine.wrap(function()
+		for i = 1, 50000 do coroutine.yield(i) end
+	end)
+	local sum = 0
+	for _ = 1, 50000 do sum = sum + gen() end
+	return sum
+end
+
+local function nbody_loop()
+	local x, v = 0.0, 1.0
+	for _ = 1, 3000000 do
+		v = v - x * 0.001
+		x = x + v * 0.001
+	end
+	return x
+end
+
+local workloads = {
+	{ "fib(24)", function() return fib(24) end },
+	{ "ackermann(2, 300)", function() return ackermann(2, 300) end },
+	{ "table.sort + closure", sort_closure },
+	{ "string.format/gsub", strings },
+	{ "spectral_norm(100)", function() return spectral_norm(100) end },
+	{ "coroutine.wrap", coroutines },
+	{ "loop without calls", nbody_loop },
+}
+
+-------------------------------------------------------------------------------
+
+local function calls(reg)
+	local total = 0
+	vt.RegistryEnumerateMeas(reg, function(m)
+		local _, stats = vt.MeasurementGet(m)
+		total = total + stats.calls
+		return 0
+	end)
+	return total
+end
+
+local function best_of(fn, profile_reg)
+	local best = math.huge
+	for _ = 1, 3 do
+		collectgarbage()
+		if profile_reg then vt.ProfileStart(profile_reg) end
+		local s = os.clock()
+		fn()
+		local d = os.clock() - s
+		if profile_reg then vt.ProfileStop() end
+		best = math.min(best, d)
+	end
+	return best
+end
+
+print(string.format("%-22s %10s %10s %9s %10s %12s", "Workload", "plain, ms", "hook, ms", "overhead", "Lua calls", "ns per call"))
+for _, w in ipairs(workloads) do
+	local name, fn = w[1], w[2]
+	local plain = best_of(fn)
+	local reg = vt.RegistryCreate()
+	local profiled = best_of(fn, reg)
+	local n = calls(reg) // 3
+	vt.RegistryClose(reg)
+	local per_call = n >= 1000 and string.format("%12.0f", (profiled - plain) * 1e9 / n) or string.format("%12s", "-")
+	print(string.format("%-22s %10.1f %10.1f %8.0f%% %10d %s", name, plain * 1e3, profiled * 1e3, (profiled / plain - 1) * 100, n, per_call))
+end
+
+-- The profile of one workload, as it appears in the vi_timing report.
+local reg = vt.RegistryCreate()
+vt.ProfileStart(reg)
+spectral_norm(50)
+vt.ProfileStop()
+print("")
+vt.RegistryReport(reg, vt.ReportDefault, io.write)
+vt.RegistryClose(reg)
@@ -0,0 +1,84 @@
+-- vi_timing.lua
+-- Demo and smoke test of the vi_timing Lua extension (Lua 5.4): run it from the directory of the module.
+
+local suffix = (os.getenv("CONFIG") == "Debug") and "_d" or ""
+local function load_module()
+	for _, name in ipairs({ "./libvi_timing_lua", "./vi_timing_lua" }) do
+		for _, ext in ipairs({ ".so", ".dll", ".dylib" }) do
+			local open = package.loadlib(name .. suffix .. ext, "luaopen_vi_timing")
+			if open then
+				return open()
+			end
+		end
+	end
+	error("Cannot find the 'vi_timing_lua' module.")
+end
+
+local vt = load_module()
+
+local N = 1000000
+local function per_call(name, fn)
+	local s = os.clock()
+	fn()
+	print(string.format("\t%-32s %6.0f ns", name, (os.clock() - s) * 1e9 / N))
+end
+
+local reg = vt.RegistryCreate()
+
+print("Cost of a measured empty block:")
+per_call("GetTicks + MeasurementAdd", function()
+	local tick, add = vt.GetTicks, vt.MeasurementAdd
+	local m = vt.RegistryGetMeas(reg, "GetTicks + MeasurementAdd")
+	for _ = 1, N do
+		local s = tick()
+		add(m, tick() - s)
+	end
+end)
+
+per_call("probe(meas)", function()
+	local probe = vt.probe
+	local m = vt.RegistryGetMeas(reg, "probe(meas)")
+	for _ = 1, N do
+		local p <close> = probe(m)
+	end
+end)
+
+per_call("prober(reg, name)", function()
+	local P = vt.prober(reg, "prober(reg, name)")
+	for _ = 1, N do
+		local p <close> = P()
+	end
+end)
+
+per_call("prober, recursive", function()
+	local P = vt.prober(reg, "prober, recursive")
+	local function rec(n)
+		local p <close> = P()
+		if n > 0 then rec(n - 1) end
+	end
+	for _ = 1, N / 10 do
+		rec(9)
+	end
+end)
+
+-- A probe is stopped once: stop() before the end of the block, or on an error.
+do
+	local p <close> = vt.prober(reg, "stopped")()
+	p:stop()
+end
+pcall(function()
+	local p <close> = vt.prober(reg, "raised")()
+	error("expected")
+end)
+
+local function calls(name)
+	local _, stats = vt.MeasurementGet(vt.RegistryGetMeas(reg, name))
+	return stats.calls
+end
+assert(calls("probe(meas)") == N and calls("prober(reg, name)") == N and calls("prober, recursive") == N)
+assert(calls("stopped") == 1 and calls("raised") == 1)
+assert(not pcall(vt.probe(vt.RegistryGetMeas(reg, "x")).stop, {}), "stop() must check its argument")
+
+print("")
+vt.RegistryReport(reg, vt.ReportDefault, io.write)
+vt.RegistryClose(reg)
@@ -4,8 +4,18 @@
 #include <vi_timing/vi_timing.h>
 
 #include <lua/lua.hpp>
+#include <lua/ldebug.h> // The profiler reads CallInfo and Proto of the bundled Lua sources.
 
 #include <cstring> // for strlen
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+	#define API_EXPORT __declspec(dllexport)
+#else
+	#define API_EXPORT __attribute__((visibility("default")))
+#endif
 
 namespace
 {
@@ -418,6 +428,224 @@ namespace
 		lua_pushinteger(L, r);
 		return 1;
 	}
+
+	// ------------------- Probe -------------------
+	// A probe times a block of Lua 5.4 code with one C call at entry and one at exit:
+	//	local p <close> = vt.probe(meas)
+	// prober() resolves the name once and caches the measurement handle in an upvalue:
+	//	local P = vt.prober(reg, name) ... local p <close> = P()
+	// The probe metatable is upvalue 1 of all these functions, so they do not look it up in the Lua registry.
+	// A stopped probe of prober() is reused by its next call, so it must not be kept after the block.
+
+	struct probe_t
+	{	VI_TM_HMEAS meas_; // nullptr after the probe has been stopped.
+		VI_TM_TICK start_;
+	};
+
+	int push_probe(lua_State *L, VI_TM_HMEAS meas)
+	{	auto p = static_cast<probe_t *>(lua_newuserdatauv(L, sizeof(probe_t), 0));
+		p->meas_ = meas;
+		lua_pushvalue(L, lua_upvalueindex(1));
+		lua_setmetatable(L, -2);
+		p->start_ = vi_tmGetTicks(); // Last, so the allocation is not measured.
+		return 1;
+	}
+
+	probe_t *check_probe(lua_State *L, int idx)
+	{	auto p = static_cast<probe_t *>(lua_touserdata(L, idx));
+		if (!p || !lua_getmetatable(L, idx) || !lua_rawequal(L, -1, lua_upvalueindex(1)))
+		{	luaL_typeerror(L, idx, "vi_timing.probe");
+		}
+		lua_pop(L, 1);
+		return p;
+	}
+
+	// probe(meas) -> probe
+	int l_probe(lua_State *L)
+	{	return push_probe(L, lua_check_meas(L, 1));
+	}
+
+	// The function returned by prober(); upvalue 2 is the measurement handle, upvalue 3 is the cached probe.
+	int l_prober_call(lua_State *L)
+	{	const auto meas = static_cast<VI_TM_HMEAS>(lua_touserdata(L, lua_upvalueindex(2)));
+		auto cached = static_cast<probe_t *>(lua_touserdata(L, lua_upvalueindex(3)));
+		if (cached->meas_) // Nested or recursive use: the cached probe is running.
+		{	return push_probe(L, meas);
+		}
+		cached->meas_ = meas;
+		lua_pushvalue(L, lua_upvalueindex(3));
+		cached->start_ = vi_tmGetTicks();
+		return 1;
+	}
+
+	// prober(reg, name) -> function() -> probe
+	int l_prober(lua_State *L)
+	{	VI_TM_HREG j = lua_check_reg(L, 1);
+		const char *name = luaL_checkstring(L, 2);
+		VI_TM_HMEAS m = vi_tmRegistryGetMeas(j, name);
+		if (!m) return 0;
+		lua_pushvalue(L, lua_upvalueindex(1));
+		lua_push_meas(L, m);
+		push_probe(L, nullptr); // A stopped probe for the first call.
+		lua_pushcclosure(L, l_prober_call, 3);
+		return 1;
+	}
+
+	// probe:stop() and the __close metamethod: add the time since the creation; a stopped probe is not added again.
+	int l_probe_stop(lua_State *L)
+	{	const auto finish = vi_tmGetTicks();
+		auto p = check_probe(L, 1);
+		if (p->meas_)
+		{	vi_tmMeasurementAdd(p->meas_, finish - p->start_, 1);
+			p->meas_ = nullptr;
+		}
+		return 0;
+	}
+
+	// ------------------- Profiler -------------------
+	// ProfileStart(reg?) installs call and return hooks that time every Lua function into the registry under
+	// the name "source:linedefined". The hook does not call lua_getinfo() on the hot path: the Proto of the
+	// function is the cache key, and the CallInfo links resynchronize the shadow stack after errors, which skip
+	// the return hooks. Coroutines created after ProfileStart() inherit the hook. A suspended coroutine keeps
+	// its frames running. Times are inclusive and contain the hook overhead of the nested calls.
+	// The shadow stack of a coroutine is dropped when its body returns. The first call of a new coroutine
+	// discards the frames left at its address by a collected one (killed by an error or never finished).
+	namespace profiler
+	{
+		struct frame_t
+		{	const CallInfo *ci_;
+			VI_TM_HMEAS meas_; // nullptr for C functions.
+			VI_TM_TICK start_;
+		};
+
+		struct entry_t
+		{	const TString *source_; // Checked on a hit: a new Proto may reuse the address of a collected one.
+			int line_;
+			VI_TM_HMEAS meas_;
+		};
+
+		constexpr std::size_t MAX_PROTOS = 4096U; // The cache is cleared when full: Protos of collected chunks are never removed.
+
+		bool active = false;
+		VI_TM_HREG registry = nullptr;
+		std::unordered_map<const Proto *, entry_t> protos;
+		std::unordered_map<const lua_State *, std::vector<frame_t>> stacks; // One per coroutine.
+		const lua_State *last_state = nullptr;
+		std::vector<frame_t> *last_stack = nullptr;
+
+		std::vector<frame_t> &stack(const lua_State *L)
+		{	if (L != last_state)
+			{	last_state = L;
+				last_stack = &stacks[L];
+			}
+			return *last_stack;
+		}
+
+		void drop(const lua_State *L)
+		{	stacks.erase(L);
+			if (L == last_state)
+			{	last_state = nullptr;
+				last_stack = nullptr;
+			}
+		}
+
+		VI_TM_HMEAS meas(lua_State *L, lua_Debug *ar)
+		{	const CallInfo *ci = ar->i_ci;
+			if (!isLua(ci))
+			{	return nullptr;
+			}
+			const Proto *p = ci_func(ci)->p;
+			auto it = protos.find(p);
+			if (protos.end() == it)
+			{	if (protos.size() >= MAX_PROTOS)
+				{	protos.clear();
+				}
+				it = protos.emplace(p, entry_t{}).first;
+			}
+			auto &e = it->second;
+			if (!e.meas_ || e.source_ != p->source || e.line_ != p->linedefined)
+			{	lua_getinfo(L, "S", ar);
+				const auto name = std::string{ ar->short_src } + ":" + std::to_string(ar->linedefined);
+				e = { p->source, p->linedefined, vi_tmRegistryGetMeas(registry, name.c_str()) };
+			}
+			return e.meas_;
+		}
+
+		void enter(std::vector<frame_t> &frames, lua_State *L, lua_Debug *ar)
+		{	frames.push_back({ ar->i_ci, meas(L, ar), 0U });
+			frames.back().start_ = vi_tmGetTicks(); // After the lookup, so it is not measured.
+		}
+
+		void hook(lua_State *L, lua_Debug *ar)
+		{	const auto finish = (LUA_HOOKCALL == ar->event) ? VI_TM_TICK{} : vi_tmGetTicks();
+			if (!active)
+			{	lua_sethook(L, nullptr, 0, 0); // A coroutine that inherited the hook before ProfileStop().
+				return;
+			}
+
+			auto &frames = stack(L);
+			const CallInfo *ci = ar->i_ci;
+			switch (ar->event)
+			{
+			case LUA_HOOKCALL:
+				// The caller is on the top, unless it was entered before the start. Frames above it were left by an error.
+				// The base CallInfo is never on the shadow stack, so the first call of a coroutine discards all the frames.
+				while (!frames.empty() && frames.back().ci_ != ci->previous)
+				{	frames.pop_back();
+				}
+				enter(frames, L, ar);
+				break;
+			case LUA_HOOKRET:
+			case LUA_HOOKTAILCALL: // The callee reuses the CallInfo of the caller, and there is one return for both.
+				while (!frames.empty() && frames.back().ci_ != ci)
+				{	frames.pop_back();
+				}
+				if (!frames.empty())
+				{	if (const auto &top = frames.back(); top.meas_)
+					{	vi_tmMeasurementAdd(top.meas_, finish - top.start_, 1);
+					}
+					frames.pop_back();
+				}
+				if (LUA_HOOKTAILCALL == ar->event)
+				{	enter(frames, L, ar);
+				}
+				else if (ci->previous == &L->base_ci)
+				{	drop(L); // The body of the coroutine (or the outermost call of the thread) has returned.
+				}
+				break;
+			default:
+				break;
+			}
+		}
+
+		void reset()
+		{	active = false;
+			registry = nullptr;
+			protos.clear();
+			stacks.clear();
+			last_state = nullptr;
+			last_stack = nullptr;
+		}
+	} // namespace profiler
+
+	// ProfileStart(reg?) -> (): profiles the calling thread and the coroutines created by it; replaces debug.sethook().
+	int l_ProfileStart(lua_State *L)
+	{
+		VI_TM_HREG j = lua_isnoneornil(L, 1) ? VI_TM_HGLOBAL : lua_check_reg(L, 1);
+		profiler::reset();
+		profiler::registry = j;
+		profiler::active = true;
+		lua_sethook(L, profiler::hook, LUA_MASKCALL | LUA_MASKRET, 0);
+		return 0;
+	}
+
+	// ProfileStop() -> ()
+	int l_ProfileStop(lua_State *L)
+	{
+		lua_sethook(L, nullptr, 0, 0);
+		profiler::reset();
+		return 0;
+	}
 } // namespace
 
 // ------------------- Module registration -------------------
@@ -429,6 +657,8 @@ static const luaL_Reg vi_timing_funcs[] = {
 	{"MeasurementGet",        l_vi_tmMeasurementGet},
 	{"MeasurementMerge",      l_vi_tmMeasurementMerge},
 	{"MeasurementReset",      l_vi_tmMeasurementReset},
+	{"ProfileStart",          l_ProfileStart},
+	{"ProfileStop",           l_ProfileStop},
 	{"RegistryClose",         l_vi_tmRegistryClose},
 	{"RegistryCreate",        l_vi_tmRegistryCreate},
 	{"RegistryEnumerateMeas", l_vi_tmRegistryEnumerateMeas},
@@ -444,9 +674,29 @@ static const luaL_Reg vi_timing_funcs[] = {
 	{nullptr, nullptr}
 };
 
-extern "C" int luaopen_vi_timing(lua_State* L) {
+// Functions with the probe metatable as the upvalue.
+static const luaL_Reg vi_timing_probe_funcs[] = {
+	{"probe",                 l_probe},
+	{"prober",                l_prober},
+	{nullptr, nullptr}
+};
+
+static const luaL_Reg vi_timing_probe_meta[] = {
+	{"__close",               l_probe_stop},
+	{"stop",                  l_probe_stop},
+	{nullptr, nullptr}
+};
+
+extern "C" API_EXPORT int luaopen_vi_timing(lua_State* L) {
 	luaL_newlib(L, vi_timing_funcs);
 
+	luaL_newmetatable(L, "vi_timing.probe"); // lib, mt
+	lua_pushvalue(L, -1);
+	luaL_setfuncs(L, vi_timing_probe_meta, 1); // mt.__close, mt.stop
+	lua_pushvalue(L, -1);
+	lua_setfield(L, -2, "__index"); // p:stop()
+	luaL_setfuncs(L, vi_timing_probe_funcs, 1); // lib.probe, lib.prober; pops mt
+
 	// Push constants that might be useful
 	lua_pushinteger(L, vi_tmReportDefault);
 	lua_setfield(L, -2, "ReportDefault");
@@ -1,5 +1,6 @@
 # vi_timing_mod.py
 
+import cProfile # For comparison with the vi_timing profiler
 import ctypes # For loading the C-extension and calling its functions
 import importlib # For dynamic loading of the C-extension module
 import importlib.machinery # For getting the extension suffixes
@@ -166,6 +167,48 @@ def check_mod():
 			vi_timing_mod.MeasurementAdd(hmes, f - s)
 		print(f"\tmeasure vi_timing_mod.DummyVoidC:\t{timeit.timeit(measure, number=100_000)*10:.2g} us")
 
+		# The native Probe and the timed decorator keep the measurement handle and the start ticks in C.
+		probe = vi_timing_mod.Probe("Probe Empty", reg_mod)
+		def measure():
+			with probe:
+				pass
+		print(f"\tmeasure Probe Empty:\t{timeit.timeit(measure, number=100_000)*10:.2g} us")
+
+		probe = vi_timing_mod.Probe("Probe DummyVoidPy", reg_mod)
+		def measure():
+			with probe:
+				DummyVoidPy()
+		print(f"\tmeasure Probe DummyVoidPy:\t{timeit.timeit(measure, number=100_000)*10:.2g} us")
+
+		measure = vi_timing_mod.timed("timed DummyVoidPy", reg_mod)(DummyVoidPy)
+		print(f"\tmeasure timed DummyVoidPy:\t{timeit.timeit(measure, number=100_000)*10:.2g} us")
+
+		measure = vi_timing_mod.timed("timed DummyFloatPy", reg_mod)(DummyFloatPy)
+		assert measure(3.14) == 3.14 and measure(f=2.0) == 2.0 and measure.__wrapped__ is DummyFloatPy
+		print(f"\tmeasure timed DummyFloatPy:\t{timeit.timeit(lambda: measure(3.14), number=100_000)*10:.2g} us")
+
+def fib(n: int)->int:
+	return n if n < 2 else fib(n - 1) + fib(n - 2)
+
+def check_profile():
+	print("\nProfiling of fib(20) (21'891 calls):")
+	print(f"\twithout profiler:\t{timeit.timeit(lambda: fib(20), number=10)*100:.3g} ms")
+
+	profile = cProfile.Profile()
+	profile.enable()
+	duration = timeit.timeit(lambda: fib(20), number=10)
+	profile.disable()
+	print(f"\tcProfile:\t{duration*100:.3g} ms")
+
+	reg_mod = vi_timing_mod.RegistryCreate()
+	vi_timing_mod.ProfileStart(reg_mod)
+	duration = timeit.timeit(lambda: fib(20), number=10)
+	vi_timing_mod.ProfileStop()
+	print(f"\tvi_timing profiler:\t{duration*100:.3g} ms")
+	vi_timing_mod.RegistryReport(reg_mod, 0)
+	print(vi_timing_mod.RegistryExport(reg_mod, vi_timing_mod.ExportCsv), end="")
+	vi_timing_mod.RegistryClose(reg_mod)
+
 def float_func_metrics(func, val: float):
 	print(f"\t{func.__module__}.{func.__name__}: \t{timeit.timeit(
 		stmt='func(val)',
@@ -212,6 +255,7 @@ if __name__ == "__main__":
 
 	check_mod()
 	check_lib()
+	check_profile()
 
 	print("")
 	print("Finish timing tests...")
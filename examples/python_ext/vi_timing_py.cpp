@@ -4,8 +4,15 @@
 
 #include <Python.h>
 
+#include <structmember.h> // For PyMemberDef and T_PYSSIZET.
+
 #include <cassert>
+#include <cstddef>
+#include <limits>
+#include <string>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
 #ifdef _WIN32
 	#define API_EXPORT __declspec(dllexport)
@@ -23,12 +30,24 @@ extern "C" API_EXPORT void DummyVoidC() noexcept
 
 namespace
 {
+	// The hot entry points use METH_FASTCALL: the arguments come as a C array, without a tuple and keyword parsing.
+	bool check_nargs(const char *fn, Py_ssize_t nargs, Py_ssize_t min, Py_ssize_t max)
+	{	if (nargs >= min && nargs <= max)
+		{	return true;
+		}
+		PyErr_Format(PyExc_TypeError, "%s() takes from %zd to %zd positional arguments but %zd were given", fn, min, max, nargs);
+		return false;
+	}
+
+	VI_TM_HREG registry_from(PyObject *obj) // None and a missing argument mean the global registry.
+	{	return (!obj || Py_None == obj) ? VI_TM_HGLOBAL : static_cast<VI_TM_HREG>(PyLong_AsVoidPtr(obj));
+	}
+
 	PyObject* py_DummyFloatC(PyObject* Py_UNUSED(self), PyObject* arg)
-	{	double value = 0.0;
-		if (!PyArg_ParseTuple(arg, "d", &value))
+	{	const double value = PyFloat_AsDouble(arg);
+		if (-1.0 == value && PyErr_Occurred())
 			return nullptr;
-		value = DummyFloatC(value);
-		return PyFloat_FromDouble(value);
+		return PyFloat_FromDouble(DummyFloatC(value));
 	}
 
 	PyObject* py_DummyVoidC(PyObject* Py_UNUSED(self), PyObject* noargs)
@@ -40,7 +59,7 @@ namespace
 	PyObject* py_vi_tmGetTicks(PyObject* Py_UNUSED(self), PyObject* noargs)
 	{	assert(nullptr == noargs);
 		VI_TM_TICK ticks = vi_tmGetTicks();
-		return PyLong_FromLongLong(ticks);
+		return PyLong_FromUnsignedLongLong(ticks);
 	}
 
 	PyObject* py_vi_tmGlobalInit(PyObject *Py_UNUSED(self), PyObject *args, PyObject *kwargs)
@@ -82,40 +101,61 @@ namespace
 		return NULL;
 	}
 
-	PyObject* py_vi_tmRegistryGetMeas(PyObject* Py_UNUSED(self), PyObject* args, PyObject* kwargs)
-	{	static constexpr const char* kwlist[] = {"jour", "name", NULL};
-		PyObject* pobj;
-		const char* name;
-		if (PyArg_ParseTupleAndKeywords(args, kwargs, "Os", const_cast<char**>(kwlist), &pobj, &name))
-		{	auto jour = static_cast<VI_TM_HREG>(PyLong_AsVoidPtr(pobj));
-			if ( !PyErr_Occurred())
+	// RegistryExport(jour, format): the text of vi_tmRegistryExport() in one of the Export* formats.
+	PyObject *py_vi_tmRegistryExport(PyObject *Py_UNUSED(self), PyObject *const *args, Py_ssize_t nargs)
+	{	if (!check_nargs("RegistryExport", nargs, 2, 2))
+		{	return NULL;
+		}
+		const auto jour = static_cast<VI_TM_HREG>(PyLong_AsVoidPtr(args[0]));
+		const auto format = PyErr_Occurred() ? -1L : PyLong_AsLong(args[1]);
+		if (PyErr_Occurred())
+		{	return NULL;
+		}
+
+		static constexpr vi_tmReportCb_t append = [](const char *str, void *ctx) -> VI_TM_RESULT
+			{	static_cast<std::string*>(ctx)->append(str);
+				return 0;
+			};
+		std::string text;
+		if (VI_FAILED(vi_tmRegistryExport(jour, static_cast<vi_tmExportFormat_e>(format), append, &text)))
+		{	PyErr_SetString(PyExc_RuntimeError, "Failed to export the registry");
+			return NULL;
+		}
+		return PyUnicode_FromStringAndSize(text.data(), static_cast<Py_ssize_t>(text.size()));
+	}
+
+	// RegistryGetMeas(jour, name)
+	PyObject* py_vi_tmRegistryGetMeas(PyObject* Py_UNUSED(self), PyObject *const *args, Py_ssize_t nargs)
+	{	if (check_nargs("RegistryGetMeas", nargs, 2, 2))
+		{	auto jour = static_cast<VI_TM_HREG>(PyLong_AsVoidPtr(args[0]));
+			const char *name = PyErr_Occurred() ? nullptr : PyUnicode_AsUTF8(args[1]);
+			if (name)
 			{	if (auto meas = vi_tmRegistryGetMeas(jour, name))
 				{	return PyLong_FromVoidPtr(meas);
 				}
 				PyErr_SetString(PyExc_RuntimeError, "Failed to get measurement");
 			}
 		}
-		assert(false);
 		return NULL;
 	}
 
-	PyObject* py_vi_tmMeasurementAdd(PyObject *Py_UNUSED(self), PyObject *args, PyObject *kwargs)
-	{	static constexpr const char *kwlist[] = { "meas", "dur", "cnt", NULL };
-		PyObject *pobj;
-		unsigned long long dur_ss;
-		Py_ssize_t cnt_ss = 1;
-		if (PyArg_ParseTupleAndKeywords(args, kwargs, "OK|n", const_cast<char**>(kwlist), &pobj, &dur_ss, &cnt_ss))
-		{
-			if(cnt_ss < 0)
-			{	PyErr_SetString(PyExc_ValueError, "cnt must be non-negative");
-			}
-			else if (auto meas = static_cast<VI_TM_HMEAS>(PyLong_AsVoidPtr(pobj)); !PyErr_Occurred())
-			{	vi_tmMeasurementAdd(meas, static_cast<VI_TM_TDIFF>(dur_ss), static_cast<VI_TM_SIZE>(cnt_ss));
-				Py_RETURN_NONE;
-			}
+	// MeasurementAdd(meas, dur, cnt=1)
+	PyObject* py_vi_tmMeasurementAdd(PyObject *Py_UNUSED(self), PyObject *const *args, Py_ssize_t nargs)
+	{	if (!check_nargs("MeasurementAdd", nargs, 2, 3))
+		{	return NULL;
 		}
-		assert(false);
-		return NULL;
+		const auto meas = static_cast<VI_TM_HMEAS>(PyLong_AsVoidPtr(args[0]));
+		const auto dur = PyErr_Occurred() ? 0ULL : PyLong_AsUnsignedLongLong(args[1]);
+		const auto cnt = (nargs < 3 || PyErr_Occurred()) ? Py_ssize_t{ 1 } : PyLong_AsSsize_t(args[2]);
+		if (PyErr_Occurred())
+		{	return NULL;
+		}
+		if (cnt < 0)
+		{	PyErr_SetString(PyExc_ValueError, "cnt must be non-negative");
+			return NULL;
+		}
+		vi_tmMeasurementAdd(meas, static_cast<VI_TM_TDIFF>(dur), static_cast<VI_TM_SIZE>(cnt));
+		Py_RETURN_NONE;
 	}
 
 	PyObject *py_vi_tmRegistryReport(PyObject *Py_UNUSED(self), PyObject *args, PyObject *kwargs)
@@ -138,17 +178,583 @@ namespace
 		return NULL;
 	}
 
+	// Probe(name, jour=HGLOBAL): a context manager that measures the 'with' block.
+	// The measurement handle is resolved once in the constructor and kept in the object, so entering
+	// and leaving the block does not create Python ints and does not look up the name.
+	// The probe must not outlive its registry. It is not reentrant: every nesting level needs its own probe.
+	struct probe_t
+	{	PyObject_HEAD
+		VI_TM_HMEAS meas_;
+		VI_TM_TICK start_;
+		bool active_;
+	};
+
+	PyObject* probe_new(PyTypeObject *type, PyObject *args, PyObject *kwargs)
+	{	static constexpr const char *kwlist[] = { "name", "jour", nullptr };
+		const char *name = nullptr;
+		PyObject *p_jour = nullptr;
+		if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|O", const_cast<char**>(kwlist), &name, &p_jour))
+		{	return NULL;
+		}
+		const auto jour = registry_from(p_jour);
+		if (PyErr_Occurred())
+		{	return NULL;
+		}
+		const auto meas = vi_tmRegistryGetMeas(jour, name);
+		if (!meas)
+		{	PyErr_SetString(PyExc_RuntimeError, "Failed to get measurement");
+			return NULL;
+		}
+		auto self = reinterpret_cast<probe_t*>(type->tp_alloc(type, 0));
+		if (self)
+		{	self->meas_ = meas;
+			self->start_ = 0U;
+			self->active_ = false;
+		}
+		return reinterpret_cast<PyObject*>(self);
+	}
+
+	void probe_dealloc(PyObject *self)
+	{	auto type = Py_TYPE(self);
+		type->tp_free(self);
+		Py_DECREF(type); // Instances of heap types own a reference to the type.
+	}
+
+	PyObject* probe_enter(PyObject *self, PyObject *Py_UNUSED(noargs))
+	{	auto probe = reinterpret_cast<probe_t*>(self);
+		if (probe->active_)
+		{	PyErr_SetString(PyExc_RuntimeError, "Probe is already entered");
+			return NULL;
+		}
+		probe->active_ = true;
+		Py_INCREF(self);
+		probe->start_ = vi_tmGetTicks(); // Last, so the bookkeeping above is not measured.
+		return self;
+	}
+
+	PyObject* probe_exit(PyObject *self, PyObject *const *Py_UNUSED(args), Py_ssize_t Py_UNUSED(nargs))
+	{	const auto finish = vi_tmGetTicks();
+		auto probe = reinterpret_cast<probe_t*>(self);
+		if (probe->active_)
+		{	probe->active_ = false;
+			vi_tmMeasurementAdd(probe->meas_, finish - probe->start_, 1);
+		}
+		Py_RETURN_NONE; // Exceptions are not suppressed.
+	}
+
+	PyObject* probe_get_meas(PyObject *self, void *Py_UNUSED(closure))
+	{	return PyLong_FromVoidPtr(reinterpret_cast<probe_t*>(self)->meas_);
+	}
+
+	PyMethodDef probe_methods[] =
+	{
+		{"__enter__", probe_enter, METH_NOARGS, "Start the measurement"},
+		{"__exit__", reinterpret_cast<PyCFunction>(probe_exit), METH_FASTCALL, "Stop the measurement and add it"},
+		{nullptr, nullptr, 0, nullptr}
+	};
+
+	PyGetSetDef probe_getset[] =
+	{
+		{"meas", probe_get_meas, nullptr, "The measurement handle", nullptr},
+		{nullptr, nullptr, nullptr, nullptr, nullptr}
+	};
+
+	PyType_Slot probe_slots[] =
+	{
+		{Py_tp_doc, const_cast<char*>("Probe(name, jour=HGLOBAL): measures the duration of a 'with' block")},
+		{Py_tp_new, reinterpret_cast<void*>(probe_new)},
+		{Py_tp_dealloc, reinterpret_cast<void*>(probe_dealloc)},
+		{Py_tp_methods, probe_methods},
+		{Py_tp_getset, probe_getset},
+		{0, nullptr}
+	};
+
+	PyType_Spec probe_spec =
+	{	"vi_timing.Probe",
+		sizeof(probe_t),
+		0,
+		Py_TPFLAGS_DEFAULT,
+		probe_slots
+	};
+
+	// Timed: the callable returned by the 'timed' decorator. It is called through vectorcall and forwards
+	// the arguments to the wrapped function unchanged; the measurement handle is cached in the object.
+	struct timed_t
+	{	PyObject_HEAD
+		vectorcallfunc vectorcall_;
+		PyObject *func_;
+		PyObject *dict_; // __name__, __doc__ etc. copied from the function, as functools.wraps() does.
+		VI_TM_HMEAS meas_;
+	};
+
+	PyTypeObject *timed_type = nullptr;
+
+	PyObject* timed_vectorcall(PyObject *callable, PyObject *const *args, size_t nargsf, PyObject *kwnames)
+	{	auto self = reinterpret_cast<timed_t*>(callable);
+		const auto start = vi_tmGetTicks();
+		auto result = PyObject_Vectorcall(self->func_, args, nargsf, kwnames);
+		const auto finish = vi_tmGetTicks();
+		vi_tmMeasurementAdd(self->meas_, finish - start, 1); // Calls that raise are measured too.
+		return result;
+	}
+
+	PyObject* timed_create(PyObject *func, PyObject *name, VI_TM_HREG jour)
+	{	if (!PyCallable_Check(func))
+		{	PyErr_SetString(PyExc_TypeError, "timed() argument must be callable");
+			return NULL;
+		}
+
+		PyObject *qualname = nullptr;
+		if (!name)
+		{	name = qualname = PyObject_GetAttrString(func, "__qualname__");
+			if (!name)
+			{	return NULL;
+			}
+		}
+		const char *str = PyUnicode_AsUTF8(name);
+		const auto meas = str ? vi_tmRegistryGetMeas(jour, str) : nullptr;
+		Py_XDECREF(qualname);
+		if (!meas)
+		{	if (!PyErr_Occurred())
+			{	PyErr_SetString(PyExc_RuntimeError, "Failed to get measurement");
+			}
+			return NULL;
+		}
+
+		auto self = PyObject_GC_New(timed_t, timed_type);
+		if (!self)
+		{	return NULL;
+		}
+		self->vectorcall_ = timed_vectorcall;
+		self->func_ = Py_NewRef(func);
+		self->dict_ = PyDict_New();
+		self->meas_ = meas;
+		PyObject_GC_Track(self);
+		if (!self->dict_)
+		{	Py_DECREF(self);
+			return NULL;
+		}
+
+		for (const char *attr : { "__module__", "__name__", "__qualname__", "__doc__" })
+		{	if (auto value = PyObject_GetAttrString(func, attr))
+			{	const auto rc = PyDict_SetItemString(self->dict_, attr, value);
+				Py_DECREF(value);
+				if (rc < 0)
+				{	Py_DECREF(self);
+					return NULL;
+				}
+			}
+			else
+			{	PyErr_Clear(); // Not every callable has all of them.
+			}
+		}
+		if (PyDict_SetItemString(self->dict_, "__wrapped__", func) < 0)
+		{	Py_DECREF(self);
+			return NULL;
+		}
+		return reinterpret_cast<PyObject*>(self);
+	}
+
+	int timed_traverse(PyObject *self, visitproc visit, void *arg)
+	{	auto timed = reinterpret_cast<timed_t*>(self);
+		Py_VISIT(Py_TYPE(self));
+		Py_VISIT(timed->func_);
+		Py_VISIT(timed->dict_);
+		return 0;
+	}
+
+	int timed_clear(PyObject *self)
+	{	auto timed = reinterpret_cast<timed_t*>(self);
+		Py_CLEAR(timed->func_);
+		Py_CLEAR(timed->dict_);
+		return 0;
+	}
+
+	void timed_dealloc(PyObject *self)
+	{	auto type = Py_TYPE(self);
+		PyObject_GC_UnTrack(self);
+		timed_clear(self);
+		PyObject_GC_Del(self);
+		Py_DECREF(type);
+	}
+
+	PyObject* timed_descr_get(PyObject *self, PyObject *obj, PyObject *Py_UNUSED(type))
+	{	if (!obj || Py_None == obj)
+		{	return Py_NewRef(self);
+		}
+		return PyMethod_New(self, obj); // Decorated methods are bound like plain functions.
+	}
+
+	PyObject* timed_get_meas(PyObject *self, void *Py_UNUSED(closure))
+	{	return PyLong_FromVoidPtr(reinterpret_cast<timed_t*>(self)->meas_);
+	}
+
+	PyGetSetDef timed_getset[] =
+	{
+		{"meas", timed_get_meas, nullptr, "The measurement handle", nullptr},
+		{nullptr, nullptr, nullptr, nullptr, nullptr}
+	};
+
+	PyMemberDef timed_members[] =
+	{
+		{"__vectorcalloffset__", T_PYSSIZET, offsetof(timed_t, vectorcall_), READONLY, nullptr},
+		{"__dictoffset__", T_PYSSIZET, offsetof(timed_t, dict_), READONLY, nullptr},
+		{nullptr, 0, 0, 0, nullptr}
+	};
+
+	PyType_Slot timed_slots[] =
+	{
+		{Py_tp_doc, const_cast<char*>("A function wrapped by the 'timed' decorator")},
+		{Py_tp_call, reinterpret_cast<void*>(PyVectorcall_Call)},
+		{Py_tp_descr_get, reinterpret_cast<void*>(timed_descr_get)},
+		{Py_tp_traverse, reinterpret_cast<void*>(timed_traverse)},
+		{Py_tp_clear, reinterpret_cast<void*>(timed_clear)},
+		{Py_tp_dealloc, reinterpret_cast<void*>(timed_dealloc)},
+		{Py_tp_members, timed_members},
+		{Py_tp_getset, timed_getset},
+		{0, nullptr}
+	};
+
+	PyType_Spec timed_spec =
+	{	"vi_timing.Timed",
+		sizeof(timed_t),
+		0,
+		Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC | Py_TPFLAGS_HAVE_VECTORCALL | Py_TPFLAGS_DISALLOW_INSTANTIATION,
+		timed_slots
+	};
+
+	// The decorator returned by timed(name, jour): its 'self' is the (name, jour) tuple.
+	PyObject* py_timed_bind(PyObject *self, PyObject *func)
+	{	const auto jour = registry_from(PyTuple_GET_ITEM(self, 1));
+		return PyErr_Occurred() ? NULL : timed_create(func, PyTuple_GET_ITEM(self, 0), jour);
+	}
+
+	PyMethodDef timed_bind_def = {"timed", py_timed_bind, METH_O, "Wrap a function"};
+
+	// @timed, @timed(name) or @timed(name, jour): the name defaults to the __qualname__ of the function.
+	PyObject* py_timed(PyObject *Py_UNUSED(self), PyObject *const *args, Py_ssize_t nargs)
+	{	if (!check_nargs("timed", nargs, 1, 2))
+		{	return NULL;
+		}
+		if (!PyUnicode_Check(args[0]))
+		{	if (nargs > 1)
+			{	PyErr_SetString(PyExc_TypeError, "timed() name must be a string");
+				return NULL;
+			}
+			return timed_create(args[0], nullptr, VI_TM_HGLOBAL);
+		}
+		auto bound = PyTuple_Pack(2, args[0], nargs > 1 ? args[1] : Py_None);
+		if (!bound)
+		{	return NULL;
+		}
+		auto result = PyCFunction_New(&timed_bind_def, bound);
+		Py_DECREF(bound);
+		return result;
+	}
+
+	// Profiler: ProfileStart() times every call of a Python function (and, optionally, of a built-in one)
+	// into a registry; the measurement name is "qualname (file:line)". Handles are cached per code object
+	// and per PyMethodDef, so a call costs one hash lookup, two ticks and vi_tmMeasurementAdd().
+	// Python 3.12+ uses sys.monitoring (tool PROFILER_ID, so it cannot run together with cProfile): the callbacks
+	// get the code object and no frame object is created. Earlier versions use PyEval_SetProfile(), which
+	// materializes a frame for every call, and profile only the thread that called ProfileStart().
+	// Times are inclusive and contain the overhead of the callbacks for the nested calls. The GIL protects the caches.
+	namespace profiler
+	{
+		struct frame_t
+		{	VI_TM_HMEAS meas_;
+			VI_TM_TICK start_;
+		};
+
+		struct stack_t
+		{	unsigned generation_ = 0U;
+			std::vector<frame_t> frames_;
+		};
+
+		VI_TM_HREG jour = nullptr;
+		bool builtins = false;
+		bool active = false;
+		unsigned generation = 0U; // Incremented by every start and stop: stacks of another generation are stale.
+		std::unordered_map<PyObject*, VI_TM_HMEAS> codes; // Owns a reference to every code object.
+		std::unordered_map<const PyMethodDef*, VI_TM_HMEAS> cfuncs;
+
+		stack_t& stack()
+		{	thread_local stack_t result;
+			if (result.generation_ != generation)
+			{	result.generation_ = generation;
+				result.frames_.clear(); // Frames entered before the start, or left after the stop.
+			}
+			return result;
+		}
+
+		std::string utf8(PyObject *obj, const char *dflt) // Steals the reference.
+		{	const char *str = obj ? PyUnicode_AsUTF8(obj) : nullptr;
+			std::string result = str ? str : dflt;
+			Py_XDECREF(obj);
+			PyErr_Clear();
+			return result;
+		}
+
+		std::string code_name(PyObject *code)
+		{	auto result = utf8(PyObject_GetAttrString(code, "co_qualname"), "<unknown>");
+			auto file = utf8(PyObject_GetAttrString(code, "co_filename"), "");
+			file.erase(0, file.find_last_of("/\\") + 1);
+			auto line = PyObject_GetAttrString(code, "co_firstlineno");
+			const auto n = line ? PyLong_AsLong(line) : -1L;
+			Py_XDECREF(line);
+			PyErr_Clear();
+			return result + " (" + file + ":" + std::to_string(n) + ")";
+		}
+
+		std::string cfunc_name(PyObject *func)
+		{	auto result = utf8(PyObject_GetAttrString(func, "__qualname__"), "<built-in>");
+			if (auto module = reinterpret_cast<PyCFunctionObject*>(func)->m_module; module && PyUnicode_Check(module))
+			{	result = PyUnicode_AsUTF8(module) + std::string{ "." } + result;
+			}
+			return result;
+		}
+
+		VI_TM_HMEAS code_meas(PyObject *code)
+		{	auto [it, inserted] = codes.try_emplace(code, nullptr);
+			if (inserted)
+			{	Py_INCREF(code);
+				it->second = vi_tmRegistryGetMeas(jour, code_name(code).c_str());
+			}
+			return it->second;
+		}
+
+		VI_TM_HMEAS cfunc_meas(PyObject *func)
+		{	auto [it, inserted] = cfuncs.try_emplace(reinterpret_cast<PyCFunctionObject*>(func)->m_ml, nullptr);
+			if (inserted)
+			{	it->second = vi_tmRegistryGetMeas(jour, cfunc_name(func).c_str());
+			}
+			return it->second;
+		}
+
+		void enter(VI_TM_HMEAS meas)
+		{	auto &frames = stack().frames_;
+			frames.push_back({ meas, 0U });
+			frames.back().start_ = vi_tmGetTicks(); // After the lookup, so it is not measured.
+		}
+
+		void leave(VI_TM_TICK finish)
+		{	if (auto &frames = stack().frames_; !frames.empty())
+			{	const auto &top = frames.back();
+				if (top.meas_)
+				{	vi_tmMeasurementAdd(top.meas_, finish - top.start_, 1);
+				}
+				frames.pop_back();
+			}
+		}
+
+		bool is_builtin(PyObject *func)
+		{	return builtins && PyCFunction_Check(func);
+		}
+
+#if PY_VERSION_HEX >= 0x030C0000
+		constexpr int tool_id = 2; // sys.monitoring.PROFILER_ID
+
+		// Arguments: (code, offset, ...).
+		PyObject* on_enter(PyObject *, PyObject *const *args, Py_ssize_t)
+		{	enter(code_meas(args[0]));
+			Py_RETURN_NONE;
+		}
+
+		PyObject* on_leave(PyObject *, PyObject *const *, Py_ssize_t)
+		{	leave(vi_tmGetTicks());
+			Py_RETURN_NONE;
+		}
+
+		// Arguments: (code, offset, callable, arg0).
+		PyObject* on_call(PyObject *, PyObject *const *args, Py_ssize_t)
+		{	if (is_builtin(args[2]))
+			{	enter(cfunc_meas(args[2]));
+			}
+			Py_RETURN_NONE;
+		}
+
+		PyObject* on_c_leave(PyObject *, PyObject *const *args, Py_ssize_t)
+		{	const auto finish = vi_tmGetTicks();
+			if (is_builtin(args[2]))
+			{	leave(finish);
+			}
+			Py_RETURN_NONE;
+		}
+
+		PyMethodDef on_enter_def = {"on_enter", reinterpret_cast<PyCFunction>(on_enter), METH_FASTCALL, nullptr};
+		PyMethodDef on_leave_def = {"on_leave", reinterpret_cast<PyCFunction>(on_leave), METH_FASTCALL, nullptr};
+		PyMethodDef on_call_def = {"on_call", reinterpret_cast<PyCFunction>(on_call), METH_FASTCALL, nullptr};
+		PyMethodDef on_c_leave_def = {"on_c_leave", reinterpret_cast<PyCFunction>(on_c_leave), METH_FASTCALL, nullptr};
+
+		struct callback_t
+		{	const char *event_;
+			PyMethodDef *def_;
+			bool builtin_;
+		};
+
+		constexpr callback_t callbacks[] =
+		{	{ "PY_START", &on_enter_def, false },
+			{ "PY_RESUME", &on_enter_def, false },
+			{ "PY_THROW", &on_enter_def, false },
+			{ "PY_RETURN", &on_leave_def, false },
+			{ "PY_YIELD", &on_leave_def, false },
+			{ "PY_UNWIND", &on_leave_def, false },
+			{ "CALL", &on_call_def, true },
+			{ "C_RETURN", &on_c_leave_def, true },
+			{ "C_RAISE", &on_c_leave_def, true },
+		};
+
+		// Registers (or with 'on' == false, unregisters) the callbacks and returns the event set, or -1 on error.
+		long monitor(PyObject *monitoring, bool on)
+		{	auto events = PyObject_GetAttrString(monitoring, "events");
+			long mask = events ? 0L : -1L;
+			for (const auto &cb : callbacks)
+			{	if (mask < 0 || (on && cb.builtin_ && !builtins))
+				{	continue;
+				}
+				auto func = on ? PyCFunction_New(cb.def_, nullptr) : Py_NewRef(Py_None);
+				auto event = PyObject_GetAttrString(events, cb.event_);
+				const auto value = event ? PyLong_AsLong(event) : -1L;
+				auto prev = (func && value >= 0) ? PyObject_CallMethod(monitoring, "register_callback", "ilO", tool_id, value, func) : nullptr;
+				mask = prev ? (mask | value) : -1L;
+				Py_XDECREF(prev);
+				Py_XDECREF(event);
+				Py_XDECREF(func);
+			}
+			Py_XDECREF(events);
+			return mask;
+		}
+
+		bool set(bool on)
+		{	auto sys = PyImport_ImportModule("sys");
+			auto monitoring = sys ? PyObject_GetAttrString(sys, "monitoring") : nullptr;
+			Py_XDECREF(sys);
+			if (!monitoring)
+			{	return false;
+			}
+			PyObject *result = nullptr;
+			if (on)
+			{	result = PyObject_CallMethod(monitoring, "use_tool_id", "is", tool_id, "vi_timing");
+				const auto mask = result ? monitor(monitoring, true) : -1L;
+				if (mask >= 0)
+				{	Py_XDECREF(result);
+					result = PyObject_CallMethod(monitoring, "set_events", "il", tool_id, mask);
+				}
+				else if (result)
+				{	Py_CLEAR(result);
+					PyObject *exc = PyErr_GetRaisedException();
+					(void)monitor(monitoring, false);
+					Py_XDECREF(PyObject_CallMethod(monitoring, "free_tool_id", "i", tool_id));
+					PyErr_SetRaisedException(exc);
+				}
+			}
+			else
+			{	result = PyObject_CallMethod(monitoring, "set_events", "ii", tool_id, 0);
+				if (result && monitor(monitoring, false) >= 0)
+				{	Py_XDECREF(result);
+					result = PyObject_CallMethod(monitoring, "free_tool_id", "i", tool_id);
+				}
+			}
+			Py_XDECREF(result);
+			Py_DECREF(monitoring);
+			return !!result;
+		}
+#else
+		int callback(PyObject *Py_UNUSED(obj), PyFrameObject *frame, int what, PyObject *arg)
+		{	switch (what)
+			{
+			case PyTrace_CALL:
+				{	auto code = reinterpret_cast<PyObject*>(PyFrame_GetCode(frame));
+					const auto meas = code_meas(code);
+					Py_DECREF(code);
+					enter(meas);
+				}
+				break;
+			case PyTrace_RETURN: // Also on the exception unwinding.
+				leave(vi_tmGetTicks());
+				break;
+			case PyTrace_C_CALL:
+				if (is_builtin(arg))
+				{	enter(cfunc_meas(arg));
+				}
+				break;
+			case PyTrace_C_RETURN:
+			case PyTrace_C_EXCEPTION:
+				if (is_builtin(arg))
+				{	leave(vi_tmGetTicks());
+				}
+				break;
+			default:
+				break;
+			}
+			return 0;
+		}
+
+		bool set(bool on)
+		{	PyEval_SetProfile(on ? callback : nullptr, nullptr);
+			return true;
+		}
+#endif
+
+		bool stop()
+		{	const bool result = !active || set(false);
+			active = false;
+			++generation;
+			for (auto &[code, meas] : codes)
+			{	Py_DECREF(code);
+			}
+			codes.clear();
+			cfuncs.clear();
+			jour = nullptr;
+			return result;
+		}
+
+		bool start(VI_TM_HREG hreg, bool with_builtins)
+		{	if (!stop())
+			{	return false;
+			}
+			jour = hreg;
+			builtins = with_builtins;
+			active = set(true);
+			return active;
+		}
+	} // namespace profiler
+
+	// ProfileStart(jour=HGLOBAL, builtins=False): the registry must stay open until ProfileStop().
+	PyObject* py_ProfileStart(PyObject *Py_UNUSED(self), PyObject *const *args, Py_ssize_t nargs)
+	{	if (!check_nargs("ProfileStart", nargs, 0, 2))
+		{	return NULL;
+		}
+		const auto jour = registry_from(nargs > 0 ? args[0] : nullptr);
+		const int builtins = (nargs > 1 && !PyErr_Occurred()) ? PyObject_IsTrue(args[1]) : 0;
+		if (PyErr_Occurred() || !profiler::start(jour, builtins > 0))
+		{	return NULL;
+		}
+		Py_RETURN_NONE;
+	}
+
+	PyObject* py_ProfileStop(PyObject *Py_UNUSED(self), PyObject *Py_UNUSED(noargs))
+	{	if (!profiler::stop())
+		{	return NULL;
+		}
+		Py_RETURN_NONE;
+	}
+
 	PyMethodDef vi_timing_methods[] =
 	{
-		{"DummyFloatC", py_DummyFloatC, METH_VARARGS, "Calculate dummy value"},
+		{"DummyFloatC", py_DummyFloatC, METH_O, "Calculate dummy value"},
 		{"DummyVoidC", py_DummyVoidC, METH_NOARGS, "DummyVoidC function"},
 		{"GetTicks", py_vi_tmGetTicks, METH_NOARGS, "Get the current time in ticks"},
 		{"GlobalInit", reinterpret_cast<PyCFunction>(py_vi_tmGlobalInit), METH_VARARGS | METH_KEYWORDS, "Initialize the timing library"},
-		{"MeasurementAdd", reinterpret_cast<PyCFunction>(py_vi_tmMeasurementAdd), METH_VARARGS | METH_KEYWORDS, "Add a measurement"},
+		{"MeasurementAdd", reinterpret_cast<PyCFunction>(py_vi_tmMeasurementAdd), METH_FASTCALL, "Add a measurement"},
 		{"RegistryClose", py_vi_tmRegistryClose, METH_O, "Close a registry"},
 		{"RegistryCreate", py_vi_tmRegistryCreate, METH_NOARGS, "Create a registry"},
-		{"RegistryGetMeas", reinterpret_cast<PyCFunction>(py_vi_tmRegistryGetMeas), METH_VARARGS | METH_KEYWORDS, "Create a measurement"},
+		{"RegistryGetMeas", reinterpret_cast<PyCFunction>(py_vi_tmRegistryGetMeas), METH_FASTCALL, "Create a measurement"},
 		{"RegistryReport", reinterpret_cast<PyCFunction>(py_vi_tmRegistryReport), METH_VARARGS | METH_KEYWORDS, "Generate a report for a registry"},
+		{"RegistryExport", reinterpret_cast<PyCFunction>(py_vi_tmRegistryExport), METH_FASTCALL, "Export a registry as JSON, CSV or Prometheus text"},
+		{"ProfileStart", reinterpret_cast<PyCFunction>(py_ProfileStart), METH_FASTCALL, "Time every Python function call into a registry"},
+		{"ProfileStop", py_ProfileStop, METH_NOARGS, "Stop the profiler"},
+		{"timed", reinterpret_cast<PyCFunction>(py_timed), METH_FASTCALL, "Decorator that measures every call of a function"},
 		{nullptr, nullptr, 0, nullptr}
 	};
 
@@ -170,7 +776,24 @@ PyMODINIT_FUNC PyInit_vi_timing(void)
 
 	PyModule_AddIntConstant(m, "ReportDefault", (int)vi_tmReportDefault);
 	PyModule_AddIntConstant(m, "SUCCESS", (int)VI_SUCCESS);
+	PyModule_AddIntConstant(m, "ExportJson", (int)vi_tmExportJson);
+	PyModule_AddIntConstant(m, "ExportCsv", (int)vi_tmExportCsv);
+	PyModule_AddIntConstant(m, "ExportPrometheus", (int)vi_tmExportPrometheus);
 	PyModule_AddObject(m, "HGLOBAL", PyLong_FromVoidPtr((void *)VI_TM_HGLOBAL));
 
+	auto probe_type = PyType_FromSpec(&probe_spec);
+	if (!probe_type || PyModule_AddObject(m, "Probe", probe_type) < 0)
+	{	Py_XDECREF(probe_type);
+		Py_DECREF(m);
+		return NULL;
+	}
+
+	timed_type = reinterpret_cast<PyTypeObject*>(PyType_FromSpec(&timed_spec));
+	if (!timed_type || PyModule_AddObject(m, "Timed", Py_NewRef(timed_type)) < 0)
+	{	Py_XDECREF(timed_type);
+		Py_DECREF(m);
+		return NULL;
+	}
+
 	return m;
 }
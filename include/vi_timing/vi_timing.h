@@ -114,6 +114,39 @@
 #	define VI_TM_STAT_USE_MINMAX 0
 #endif
 
+// Set the VI_TM_STAT_USE_CPUTIME macro to TRUE to also measure the thread CPU time in probes
+// and to report the CPU and off-CPU (blocked, preempted) time of each measurement.
+// Library rebuild required
+#ifndef VI_TM_STAT_USE_CPUTIME
+#	define VI_TM_STAT_USE_CPUTIME 0
+#endif
+
+// Set the VI_TM_STAT_USE_PERF macro to TRUE to also read the Linux perf_event counters of the thread in probes:
+// instructions, cycles, LLC misses and branch misses, or software events if there is no hardware PMU (see vi_tmPerfRead).
+// Library rebuild required
+#ifndef VI_TM_STAT_USE_PERF
+#	define VI_TM_STAT_USE_PERF 0
+#endif
+#define VI_TM_PERF_COUNTERS (4U) // Number of counters read by vi_tmPerfRead.
+
+// Set the VI_TM_STAT_USE_RUSAGE macro to TRUE to also snapshot getrusage(RUSAGE_THREAD) in probes:
+// voluntary and involuntary context switches, minor and major page faults (see vi_tmRusageRead).
+// Library rebuild required
+#ifndef VI_TM_STAT_USE_RUSAGE
+#	define VI_TM_STAT_USE_RUSAGE 0
+#endif
+#define VI_TM_RUSAGE_COUNTERS (4U) // Number of counters read by vi_tmRusageRead.
+
+// Set the VI_TM_PROBE_NESTED macro to FALSE to make probes (vi_tm::scoped_probe_t) report via vi_tmMeasurementAdd
+// instead of vi_tmMeasurementAddNested: two calls per probe less, but the cost of nested probes stays in the parents.
+// With it, the statistics of the probes are stored already compensated (see vi_tmMeasurementAddNested).
+// It changes the layout of vi_tm::scoped_probe_t, so it must be the same in all translation units; it is a public
+// definition of the library target.
+// Library rebuild required
+#ifndef VI_TM_PROBE_NESTED
+#	define VI_TM_PROBE_NESTED 1
+#endif
+
 // If VI_TM_EXPORTS defined, the library is built as a shared and exports its functions.
 #ifndef VI_TM_EXPORTS
 #	define VI_TM_EXPORTS 0
@@ -244,10 +277,12 @@ typedef uint32_t VI_TM_FLAGS;
 typedef double VI_TM_FP; // Floating-point type used for timing calculations, typically double precision.
 typedef uintptr_t VI_TM_SIZE; // Size type used for counting events, typically size_t.
 typedef uint64_t VI_TM_TICK; // !!! UNSIGNED !!! Represents a tick count (typically from a high-resolution timer). VI_TM_TICK and VI_TM_TDIFF are always unsigned to handle timer wraparound safely.
+typedef VI_TM_TICK VI_TM_SPAN; // Token of an asynchronous span (see vi_tmSpanBegin). A plain value that can be copied between threads.
 typedef VI_TM_TICK VI_TM_TDIFF; // !!! UNSIGNED !!! Wraparound counter. Represents a difference between two tick counts (duration). Do NOT compare to zero as signed. If a signed value is needed (e.g. for debugging/printing), cast explicitly.
 typedef struct vi_tmMeasurement_t *VI_TM_HMEAS; // Opaque handle to a measurement entry.
 typedef struct vi_tmRegistry_t *VI_TM_HREG; // Opaque handle to a measurements registry.
 typedef VI_TM_RESULT (VI_TM_CALL *vi_tmMeasEnumCb_t)(VI_TM_HMEAS hmeas, void* ctx); // Callback type for enumerating measurements; returning non-zero aborts enumeration.
+typedef void (VI_TM_CALL *vi_tmBenchFn_t)(void* ctx); // Benchmarked function type (see vi_tmBench).
 typedef VI_TM_RESULT (VI_SYS_CALL *vi_tmReportCb_t)(const char* str, void* ctx); // Callback must be callable from C with same calling convention as library; default implementation use std::fputs or OutputDebugString on Windows.
 
 // Save current packing alignment and set maximum alignment to 16. Since all fields 
@@ -274,9 +309,26 @@ typedef struct vi_tmStats_t
 	VI_TM_FP min_; // Initialized to VI_TM_FP_POSITIVE_INF by vi_tmStatsReset! Minimum time taken for a single event, in ticks.
 	VI_TM_FP max_; // Initialized to VI_TM_FP_NEGATIVE_INF by vi_tmStatsReset! Maximum time taken for a single event, in ticks.
 #endif
+#if VI_TM_STAT_USE_CPUTIME
+	VI_TM_TDIFF cpu_;		// Thread CPU time spent in all calls that measured it, in nanoseconds (see vi_tmMeasurementAddCpu).
+#endif
+#if VI_TM_STAT_USE_PERF
+	VI_TM_TDIFF perf_[VI_TM_PERF_COUNTERS]; // Sums of the perf_event counters of all calls that read them (see vi_tmPerfCounterName).
+#endif
+#if VI_TM_STAT_USE_RUSAGE
+	VI_TM_TDIFF rusage_[VI_TM_RUSAGE_COUNTERS]; // Sums of the getrusage counters of all calls that read them (see vi_tmRusageRead).
+#endif
 } vi_tmStats_t;
 #pragma pack(pop) // Restore previous packing alignment
 
+// vi_tmCounters_t: Thread counters of a measured interval, besides its duration (see vi_tmMeasurementAddEx).
+// The layout does not depend on the build options; the library ignores the counters it does not collect.
+typedef struct vi_tmCounters_t
+{	VI_TM_TDIFF cpu_;		// Thread CPU time, in nanoseconds (see vi_tmGetThreadCpuTime).
+	VI_TM_TDIFF perf_[VI_TM_PERF_COUNTERS]; // perf_event counters (see vi_tmPerfRead).
+	VI_TM_TDIFF rusage_[VI_TM_RUSAGE_COUNTERS]; // getrusage counters (see vi_tmRusageRead).
+} vi_tmCounters_t;
+
 // Positive and negative infinity constants used for min/max statistics calculations.
 #if VI_TM_STAT_USE_MINMAX
 VI_TM_API extern const VI_TM_FP VI_TM_FP_POSITIVE_INF;
@@ -310,9 +362,9 @@ typedef enum vi_tmReportFlags_e
 	vi_tmSortByName		= 0x01, // sort by measurement name.
 	vi_tmSortBySpeed	= 0x02, // sort by average time per event (speed).
 	vi_tmSortByAmount	= 0x03, // sort by the number of events measured.
-	vi_tmSortByMin		= 0x04, // fake sort by minimum time (Sorting has not yet been implemented).
-	vi_tmSortByMax		= 0x05, // fake sort by maximum time (Sorting has not yet been implemented).
-	vi_tmSortByCV		= 0x06, // fake sort by coefficient of variation (Sorting has not yet been implemented).
+	vi_tmSortByMin		= 0x04, // sort by minimum time (requires VI_TM_STAT_USE_MINMAX, otherwise sorts by name).
+	vi_tmSortByMax		= 0x05, // sort by maximum time (requires VI_TM_STAT_USE_MINMAX, otherwise sorts by name).
+	vi_tmSortByCV		= 0x06, // sort by coefficient of variation (requires VI_TM_STAT_USE_RMSE, otherwise sorts by name).
 	vi_tmSortMask		= 0x07, // 0b0111
 
 	vi_tmSortAscending			= 1 << 3, // sort in ascending order.
@@ -326,13 +378,58 @@ typedef enum vi_tmReportFlags_e
 	vi_tmShowMask				= 0x03F0, // 0b0011'1111'0000
 
 	vi_tmHideHeader				= 1 << 10, // If set, the report will not show the header with column names.
-	vi_tmDoNotSubtractOverhead	= 1 << 11, // If set, the overhead is not subtracted from the measured time in report.
+	vi_tmDoNotSubtractOverhead	= 1 << 11, // If set, the clock overhead is not subtracted from the measured time in report; the compensation of nested probes is already in the statistics (see vi_tmMeasurementAddNested).
 	vi_tmDoNotReport			= 1 << 12, // If set, no report will be generated.
 
 	vi_tmReportFlagsMask		= 0x1FFF, // 0b0001'1111'1111'1111
 	vi_tmReportDefault			= vi_tmShowResolution | vi_tmShowDuration | vi_tmSortByTime,
 } vi_tmReportFlags_e;
 
+// vi_tmExportFormat_e: Machine-readable formats of vi_tmRegistryExport.
+typedef enum vi_tmExportFormat_e
+{
+	vi_tmExportJson			= 0, // JSON object with "seconds_per_tick", "overhead_ticks" and the "measurements" array.
+	vi_tmExportCsv			= 1, // CSV with a header line; unavailable values are empty.
+	vi_tmExportPrometheus	= 2, // Prometheus text exposition format; the measurement name is the "name" label.
+} vi_tmExportFormat_e;
+
+// vi_tmBenchFlags_e: Flags of vi_tmBenchOptions_t.
+typedef enum vi_tmBenchFlags_e
+{
+	vi_tmBenchNoAffinity	= 1 << 0, // Do not fixate the thread on the current CPU.
+	vi_tmBenchNoWarmUp		= 1 << 1, // Do not load the CPU before the run (see vi_WarmUp); the first batches are still discarded.
+} vi_tmBenchFlags_e;
+
+// vi_tmBenchOptions_t: Options of vi_tmBench. Zero fields take the default values.
+typedef struct vi_tmBenchOptions_t
+{	double target_rse_;		// Stop when the relative standard error of the mean drops to this value. Default: 0.01.
+	double max_seconds_;	// Time limit of the run, including calibration. Default: 1 s.
+	double batch_seconds_;	// Minimum duration of one batch; the number of iterations per batch is chosen to reach it. Default: 1 ms.
+	VI_TM_SIZE min_batches_;	// Minimum number of measured batches. Default: 10.
+	VI_TM_SIZE max_batches_;	// Maximum number of measured batches. Default: 1000.
+	unsigned flags_;		// Combination of vi_tmBenchFlags_e.
+} vi_tmBenchOptions_t;
+
+// vi_tmBenchResult_t: Result of vi_tmBench.
+typedef struct vi_tmBenchResult_t
+{	VI_TM_SIZE batches_;	// Number of measured batches (calls added to the measurement).
+	VI_TM_SIZE iterations_;	// Number of iterations per batch.
+	double mean_;			// Mean duration of one iteration, in seconds, with the loop and call overhead subtracted.
+	double rse_;			// Relative standard error of the mean.
+} vi_tmBenchResult_t;
+
+// vi_tmBenchABResult_t: Result of vi_tmBenchAB. The speedup is the ratio of the mean durations A / B: above 1 - B is faster.
+typedef struct vi_tmBenchABResult_t
+{	vi_tmBenchResult_t a_;
+	vi_tmBenchResult_t b_;
+	double speedup_;		// Mean duration of A divided by mean duration of B.
+	double speedup_lo_;		// Lower bound of the 95% confidence interval of the speedup.
+	double speedup_hi_;		// Upper bound of the 95% confidence interval of the speedup.
+	double t_;				// Welch's t statistic of the difference of the means.
+	double df_;				// Welch-Satterthwaite degrees of freedom.
+	int verdict_;			// 1 - B is faster than A, -1 - B is slower, 0 - the difference is not significant at the 95% level.
+} vi_tmBenchABResult_t;
+
 typedef enum vi_tmStatus_e
 {
 	vi_tmDebug			= 1 << 0,
@@ -342,7 +439,11 @@ typedef enum vi_tmStatus_e
 	vi_tmStatUseRMSE	= 1 << 4,
 	vi_tmStatUseFilter	= 1 << 5,
 	vi_tmStatUseMinMax	= 1 << 6,
-	vi_tmStatusMask		= 0x7F, // 0b0111'1111
+	vi_tmStatUseCpuTime	= 1 << 7,
+	vi_tmStatUsePerf	= 1 << 8,
+	vi_tmStatUseRusage	= 1 << 9,
+	vi_tmProbeNested	= 1 << 10,
+	vi_tmStatusMask		= 0x7FF, // 0b111'1111'1111
 } vi_tmStatus_e;
 
 #define VI_TM_HGLOBAL ((VI_TM_HREG)-1) // Global registry handle, used for global measurements.
@@ -354,6 +455,37 @@ typedef enum vi_tmStatus_e
 /// <returns>A current tick count.</returns>
 VI_NODISCARD VI_TM_API VI_TM_TICK VI_TM_CALL vi_tmGetTicks(void) VI_NOEXCEPT;
 
+/// <summary>
+/// Returns the CPU time consumed by the calling thread (user and kernel), in nanoseconds.
+/// The granularity depends on the OS (CLOCK_THREAD_CPUTIME_ID on POSIX, GetThreadTimes on Windows).
+/// </summary>
+/// <returns>The CPU time of the current thread in nanoseconds.</returns>
+VI_NODISCARD VI_TM_API VI_TM_TICK VI_TM_CALL vi_tmGetThreadCpuTime(void) VI_NOEXCEPT;
+
+/// <summary>
+/// Reads the perf_event counters of the calling thread (Linux only). The counter group is opened on the first call in each thread
+/// and closed when the thread exits. Hardware counters are read with rdpmc when the kernel allows it, otherwise with read().
+/// Without a hardware PMU (containers, VMs) software events are counted instead; see vi_tmPerfCounterName.
+/// </summary>
+/// <param name="dst">Receives VI_TM_PERF_COUNTERS current counter values; zeros on failure.</param>
+/// <returns>VI_SUCCESS, or VI_FAILURE if perf_event is unavailable.</returns>
+VI_TM_API VI_TM_RESULT VI_TM_CALL vi_tmPerfRead(VI_TM_TDIFF *dst) VI_NOEXCEPT;
+
+/// <summary>
+/// Returns the name of the counter at index 'idx' of vi_tmPerfRead: "instructions", "cycles", "llc-misses", "branch-misses",
+/// or "task-clock" (nanoseconds), "page-faults", "context-switches", "cpu-migrations" for the software fallback.
+/// </summary>
+/// <returns>The name, or nullptr if 'idx' is out of range or perf_event is unavailable.</returns>
+VI_NODISCARD VI_TM_API const char* VI_TM_CALL vi_tmPerfCounterName(unsigned idx) VI_NOEXCEPT;
+
+/// <summary>
+/// Reads getrusage(RUSAGE_THREAD) of the calling thread: voluntary context switches, involuntary context switches
+/// (preemptions), minor page faults and major page faults, in this order. Available on Linux only.
+/// </summary>
+/// <param name="dst">Receives VI_TM_RUSAGE_COUNTERS current counter values; zeros on failure.</param>
+/// <returns>VI_SUCCESS, or VI_FAILURE if per-thread resource usage is unavailable.</returns>
+VI_TM_API VI_TM_RESULT VI_TM_CALL vi_tmRusageRead(VI_TM_TDIFF *dst) VI_NOEXCEPT;
+
 /// <summary>
 /// Configures the appearance of the global registry report.
 /// </summary>
@@ -383,13 +515,62 @@ VI_NODISCARD VI_TM_API VI_TM_HREG VI_TM_CALL vi_tmRegistryCreate();
 
 /// <summary>
 /// Resets but does not delete all entries in the registry. All entry handles remain valid.
+/// Takes constant time: each entry is cleared on its next update and is reported as empty until then
+/// (the live statistics page keeps showing its old values until that update).
 /// </summary>
 /// <param name="hreg">The handle to the registry to reset.</param>
 /// <returns>This function does not return a value.</returns>
 VI_TM_API void VI_TM_CALL vi_tmRegistryReset(VI_TM_HREG hreg) VI_NOEXCEPT;
 
 /// <summary>
-/// Closes and deletes a registry handle. All descriptors associated with the registry become invalid.
+/// Merges the statistics of all measurements of the source registry into the destination registry
+/// (see vi_tmStatsMerge). Missing measurements are created in the destination. The source is not changed.
+/// </summary>
+/// <param name="dst">The handle to the destination registry.</param>
+/// <param name="src">The handle to the source registry. Must differ from 'dst'.</param>
+/// <returns>The number of merged measurements, or a negative error code.</returns>
+VI_TM_API VI_TM_RESULT VI_TM_CALL vi_tmRegistryMerge(VI_TM_HREG dst, VI_TM_HREG src);
+
+/// <summary>
+/// Returns the private registry of the calling thread, creating it on the first call.
+/// When the thread exits, its measurements are merged into the parent registry and the registry is closed.
+/// Measurements of a private registry are never contended, and the parent is locked only once per thread.
+/// </summary>
+/// <param name="parent">The registry that receives the measurements at thread exit. It must outlive the thread.
+/// Only the value passed on the first call in a thread is used.</param>
+/// <returns>A handle to the thread-local registry, or nullptr on failure. Do not close it.</returns>
+VI_NODISCARD VI_TM_API VI_TM_HREG VI_TM_CALL vi_tmThreadLocalRegistry(VI_TM_HREG parent VI_DEFAULT(VI_TM_HGLOBAL));
+
+/// <summary>
+/// Removes the measurement from the registry: it is no longer enumerated, reported or mirrored.
+/// Updates through its handle are kept but not reported until vi_tmRegistryReclaim is called.
+/// A later vi_tmRegistryGetMeas with the same name revives the measurement and returns the same handle.
+/// </summary>
+/// <param name="hreg">The handle to the registry containing the measurement.</param>
+/// <param name="hmeas">The handle to the measurement to remove.</param>
+/// <returns>Returns VI_SUCCESS (0) on success; otherwise (e.g. the measurement is already removed), returns a negative error code.</returns>
+VI_TM_API VI_TM_RESULT VI_TM_CALL vi_tmRegistryRemoveMeas(VI_TM_HREG hreg, VI_TM_HMEAS hmeas);
+
+/// <summary>
+/// Starts a new eviction cycle (e.g. once per report) and removes (see vi_tmRegistryRemoveMeas)
+/// the measurements that have had no new calls for the given number of consecutive cycles.
+/// </summary>
+/// <param name="hreg">The handle to the registry.</param>
+/// <param name="cycles">Number of idle cycles after which a measurement is removed.</param>
+/// <returns>The number of removed measurements, or a negative error code.</returns>
+VI_TM_API VI_TM_RESULT VI_TM_CALL vi_tmRegistryEvictIdle(VI_TM_HREG hreg, unsigned cycles);
+
+/// <summary>
+/// Releases the removed measurements for reuse. It is safe while other threads hold their handles
+/// (e.g. cached in static variables by VI_TM macros): such handles become outdated, updates through them
+/// are ignored, and vi_tmMeasurementGet reports an empty name and no calls.
+/// </summary>
+/// <param name="hreg">The handle to the registry.</param>
+/// <returns>The number of freed measurements, or a negative error code.</returns>
+VI_TM_API VI_TM_RESULT VI_TM_CALL vi_tmRegistryReclaim(VI_TM_HREG hreg);
+
+/// <summary>
+/// Closes and deletes a registry handle. The handles of its measurements become outdated (see vi_tmRegistryReclaim).
 /// </summary>
 /// <param name="hreg">The handle to the registry to be closed and deleted.</param>
 /// <returns>This function does not return a value.</returns>
@@ -397,7 +578,8 @@ VI_TM_API void VI_TM_CALL vi_tmRegistryClose(VI_TM_HREG hreg);
 	
 /// <summary>
 /// Retrieves a handle to the measurement associated with the given name, creating it if it does not exist.
-/// Handle does not need to be released; it will remain valid as long as the registry exists.
+/// Handle does not need to be released; it refers to the measurement as long as the registry exists (or until vi_tmRegistryReclaim after its removal)
+/// and is safely ignored afterwards.
 /// </summary>
 /// <param name="hreg">The handle to the registry containing the measurement.</param>
 /// <param name="name">The name of the measurement entry to retrieve.</param>
@@ -433,6 +615,85 @@ VI_TM_API void VI_TM_CALL vi_tmMeasurementAdd(
 	VI_TM_SIZE cnt VI_DEFAULT(1)
 ) VI_NOEXCEPT;
 
+/// <summary>
+/// Same as vi_tmMeasurementAdd, but also adds the thread CPU time consumed during the measured interval.
+/// The CPU time is ignored unless the library is built with VI_TM_STAT_USE_CPUTIME.
+/// </summary>
+/// <param name="hmeas">A handle to the measurement to be updated.</param>
+/// <param name="dur">The duration value to add to the measurement, in ticks.</param>
+/// <param name="cpu">The thread CPU time of the interval, in nanoseconds (see vi_tmGetThreadCpuTime).</param>
+/// <param name="cnt">The number of measured events.</param>
+/// <returns>This function does not return a value.</returns>
+VI_TM_API void VI_TM_CALL vi_tmMeasurementAddCpu(
+	VI_TM_HMEAS hmeas,
+	VI_TM_TDIFF dur,
+	VI_TM_TDIFF cpu,
+	VI_TM_SIZE cnt VI_DEFAULT(1)
+) VI_NOEXCEPT;
+
+/// <summary>
+/// Same as vi_tmMeasurementAdd, but also adds the thread counter deltas of the measured interval.
+/// Only the counters enabled by VI_TM_STAT_USE_CPUTIME, VI_TM_STAT_USE_PERF and VI_TM_STAT_USE_RUSAGE are accumulated.
+/// </summary>
+/// <param name="hmeas">A handle to the measurement to be updated.</param>
+/// <param name="dur">The duration value to add to the measurement, in ticks.</param>
+/// <param name="ctr">The counter deltas of the interval, or nullptr.</param>
+/// <param name="cnt">The number of measured events.</param>
+/// <returns>This function does not return a value.</returns>
+VI_TM_API void VI_TM_CALL vi_tmMeasurementAddEx(
+	VI_TM_HMEAS hmeas,
+	VI_TM_TDIFF dur,
+	const vi_tmCounters_t *ctr,
+	VI_TM_SIZE cnt VI_DEFAULT(1)
+) VI_NOEXCEPT;
+
+/// <summary>
+/// Starts an asynchronous span: a time interval that may end on another thread (see vi_tmSpanEnd).
+/// The token does not own any resources, so an unfinished span needs no cleanup.
+/// </summary>
+/// <returns>The token of the span.</returns>
+VI_NODISCARD VI_TM_API VI_TM_SPAN VI_TM_CALL vi_tmSpanBegin(void) VI_NOEXCEPT;
+
+/// <summary>
+/// Ends an asynchronous span and adds its duration to the measurement. Can be called from any thread.
+/// The clock must be synchronized between processors (an invariant TSC on x86). A span that ends before it began
+/// (unsynchronized clocks or an invalid token) is added with zero duration.
+/// </summary>
+/// <param name="hmeas">A handle to the measurement to be updated.</param>
+/// <param name="token">The token returned by vi_tmSpanBegin.</param>
+/// <param name="cnt">The number of measured events.</param>
+/// <returns>This function does not return a value.</returns>
+VI_TM_API void VI_TM_CALL vi_tmSpanEnd(VI_TM_HMEAS hmeas, VI_TM_SPAN token, VI_TM_SIZE cnt VI_DEFAULT(1)) VI_NOEXCEPT;
+
+/// <summary>
+/// Returns the counter of the probes that have finished on the calling thread via vi_tmMeasurementAddNested.
+/// The difference of two values read on the same thread is the number of probes nested in the interval between them.
+/// </summary>
+/// <returns>The counter of the calling thread: the id of the thread in the high half and the wrapping number of its probes in the low half.</returns>
+VI_NODISCARD VI_TM_API VI_TM_SIZE VI_TM_CALL vi_tmNestedProbes(void) VI_NOEXCEPT;
+
+/// <summary>
+/// Same as vi_tmMeasurementAddEx, but first subtracts the instrumentation cost of the probes nested in the interval
+/// ('nested' times vi_tmInfoDuration, not below zero), and then counts the interval itself as a nested probe of the calling thread.
+/// A 'nested' value obtained across threads is recognized by the id of the thread in it, and nothing is subtracted.
+/// The compensation is applied to the sample before it is stored: the sum, the mean and the outlier filter, min and max
+/// all see the compensated value, and the subtracted amount is not recorded. Neither vi_tmDoNotSubtractOverhead nor the
+/// exports can restore the raw time; use vi_tmMeasurementAddEx (or build with VI_TM_PROBE_NESTED=OFF) to keep it.
+/// </summary>
+/// <param name="hmeas">A handle to the measurement to be updated.</param>
+/// <param name="dur">The duration value to add to the measurement, in ticks.</param>
+/// <param name="nested">The number of probes that finished inside the interval (see vi_tmNestedProbes).</param>
+/// <param name="ctr">The counter deltas of the interval, or nullptr.</param>
+/// <param name="cnt">The number of measured events.</param>
+/// <returns>This function does not return a value.</returns>
+VI_TM_API void VI_TM_CALL vi_tmMeasurementAddNested(
+	VI_TM_HMEAS hmeas,
+	VI_TM_TDIFF dur,
+	VI_TM_SIZE nested,
+	const vi_tmCounters_t *ctr,
+	VI_TM_SIZE cnt VI_DEFAULT(1)
+) VI_NOEXCEPT;
+
 /// <summary>
 /// Merges the statistics from the given source measurement stats into the specified measurement handle.
 /// </summary>
@@ -446,7 +707,7 @@ VI_TM_API void VI_TM_CALL vi_tmMeasurementMerge(VI_TM_HMEAS hmeas, const vi_tmSt
 /// </summary>
 /// <param name="hmeas">The measurement handle from which to retrieve information.</param>
 /// <param name="name">Pointer to receive the measurement name string.
-/// The returned string is owned by the registry and remains valid until the registry is destroyed.
+/// The returned string is owned by the registry and remains valid until the measurement is reclaimed or the registry is destroyed.
 /// Can be NULL if name is not needed.
 /// </param>
 /// <param name="dst">Pointer to user-allocated vi_tmStats_t structure that will be filled with a copy
@@ -518,7 +779,7 @@ VI_TM_API VI_TM_RESULT VI_SYS_CALL vi_tmReportCb(const char *str, void *ignored
 /// </summary>
 /// <param name="hreg">The handle to the registry whose data will be reported.</param>
 /// <param name="flags">Flags that control the formatting and content of the report.</param>
-/// <param name="cb">A callback function used to output each line of the report. If nullptr, defaults to writing to a FILE* stream.</param>
+/// <param name="cb">A callback function used to output the report text. It receives one or more complete lines per call. If nullptr, defaults to writing to a FILE* stream.</param>
 /// <param name="ctx">A pointer to user data passed to the callback function. If 'cb' is nullptr and 'ctx' is nullptr, defaults to stdout.</param>
 /// <returns>The total number of characters written by the report, or a negative value if an error occurs.</returns>
 VI_TM_API VI_TM_RESULT VI_TM_CALL vi_tmRegistryReport(
@@ -527,6 +788,137 @@ VI_TM_API VI_TM_RESULT VI_TM_CALL vi_tmRegistryReport(
 	vi_tmReportCb_t cb VI_DEFAULT(vi_tmReportCb),
 	void* ctx VI_DEFAULT(nullptr)
 );
+
+/// <summary>
+/// Generates a report for a subset of the registry: only the measurements whose names match the filter,
+/// and only the first 'top' of them in the order specified by the sort flags.
+/// </summary>
+/// <param name="hreg">The handle to the registry whose data will be reported.</param>
+/// <param name="flags">Flags that control the formatting and content of the report.</param>
+/// <param name="top">Maximum number of measurements in the report. Zero means no limit.</param>
+/// <param name="filter">Glob pattern for measurement names ('*' - any sequence, '?' - any character), e.g. "db.*". NULL or empty means no filter.</param>
+/// <param name="cb">A callback function used to output the report text. It receives one or more complete lines per call.</param>
+/// <param name="ctx">A pointer to user data passed to the callback function.</param>
+/// <returns>The total number of characters written by the report, or a negative value if an error occurs.</returns>
+VI_TM_API VI_TM_RESULT VI_TM_CALL vi_tmRegistryReportEx(
+	VI_TM_HREG hreg,
+	VI_TM_FLAGS flags,
+	VI_TM_SIZE top,
+	const char *filter,
+	vi_tmReportCb_t cb VI_DEFAULT(vi_tmReportCb),
+	void* ctx VI_DEFAULT(nullptr)
+);
+
+/// <summary>
+/// Exports the statistics of all measurements in a machine-readable format.
+/// Values: calls; raw ticks, events and seconds (VI_TM_STAT_USE_RAW); filtered calls and events, mean
+/// and standard deviation (VI_TM_STAT_USE_RMSE); min and max (VI_TM_STAT_USE_MINMAX); CPU time (VI_TM_STAT_USE_CPUTIME);
+/// perf_event counters (VI_TM_STAT_USE_PERF); context switches and page faults (VI_TM_STAT_USE_RUSAGE).
+/// Times are in seconds, with the clock overhead subtracted as in the report. The "ticks" are the recorded values: for samples
+/// added via vi_tmMeasurementAddNested (the probes with VI_TM_PROBE_NESTED) they are already compensated for nested probes.
+/// </summary>
+/// <param name="hreg">The handle to the registry to export.</param>
+/// <param name="format">The output format, one of vi_tmExportFormat_e.</param>
+/// <param name="cb">A callback function used to output the text. It receives one or more complete lines per call.</param>
+/// <param name="ctx">A pointer to user data passed to the callback function.</param>
+/// <returns>The sum of the values returned by the callback, or a negative value if an error occurs.</returns>
+VI_TM_API VI_TM_RESULT VI_TM_CALL vi_tmRegistryExport(
+	VI_TM_HREG hreg,
+	vi_tmExportFormat_e format,
+	vi_tmReportCb_t cb VI_DEFAULT(vi_tmReportCb),
+	void* ctx VI_DEFAULT(nullptr)
+);
+
+/// <summary>
+/// Compares two snapshots of a registry (CSV exports, see vi_tmRegistryExport) measurement by measurement and prints
+/// a table: the mean times, the relative change, Welch's t statistic and the verdict. A measurement is regressed if
+/// its mean grew by more than the threshold and the difference is significant at the 95% level. Without the standard
+/// deviation in the snapshots (VI_TM_STAT_USE_RMSE is off) only the threshold is checked.
+/// </summary>
+/// <param name="base">The text of the baseline snapshot.</param>
+/// <param name="curr">The text of the current snapshot.</param>
+/// <param name="threshold">The relative slowdown that is not yet a regression, e.g. 0.05 - 5%.</param>
+/// <param name="cb">A callback function used to output the table. It receives one or more complete lines per call.</param>
+/// <param name="ctx">A pointer to user data passed to the callback function.</param>
+/// <returns>The number of regressed measurements, or a negative value if a snapshot is malformed.</returns>
+VI_TM_API VI_TM_RESULT VI_TM_CALL vi_tmSnapshotDiff(
+	const char *base,
+	const char *curr,
+	double threshold,
+	vi_tmReportCb_t cb VI_DEFAULT(vi_tmReportCb),
+	void* ctx VI_DEFAULT(nullptr)
+);
+
+/// <summary>
+/// Runs a micro-benchmark of the function. The function is called in batches whose length is chosen automatically
+/// (see vi_tmBenchOptions_t::batch_seconds_). The thread is fixated on the current CPU and the CPU is warmed up,
+/// the first batches are discarded. Each batch is added to the measurement 'name' as one call of 'iterations' events,
+/// with the cost of the loop and of the indirect call subtracted. The run stops when the relative standard error
+/// of the mean reaches the target, after the maximum number of batches, or when the time limit expires.
+/// </summary>
+/// <param name="hreg">The handle to the registry that receives the measurement.</param>
+/// <param name="name">The name of the measurement.</param>
+/// <param name="fn">The function to benchmark.</param>
+/// <param name="ctx">A pointer to user data passed to the function.</param>
+/// <param name="opt">The options of the run, or nullptr for the defaults.</param>
+/// <param name="result">Pointer to receive the result of the run. Can be NULL.</param>
+/// <returns>Returns VI_SUCCESS (0) on success; otherwise, returns a negative error code.</returns>
+VI_TM_API VI_TM_RESULT VI_TM_CALL vi_tmBench(
+	VI_TM_HREG hreg,
+	const char *name,
+	vi_tmBenchFn_t fn,
+	void *ctx,
+	const vi_tmBenchOptions_t *opt VI_DEFAULT(nullptr),
+	vi_tmBenchResult_t *result VI_DEFAULT(nullptr)
+);
+
+/// <summary>
+/// Compares two variants of the code (see vi_tmBench). Both use the same batch length and their batches alternate
+/// in the ABBA order, so a drift of the CPU frequency or temperature affects both variants equally.
+/// The verdict is given by Welch's t-test on the filtered mean and variance of the batches (flt_avg_ and flt_ss_);
+/// the batches are also added to the measurements 'name_a' and 'name_b'. The run stops when both variants reach
+/// the target relative standard error, after the maximum number of batches, or when the time limit expires.
+/// Requires VI_TM_STAT_USE_RMSE.
+/// </summary>
+/// <param name="hreg">The handle to the registry that receives the measurements.</param>
+/// <param name="name_a">The name of the measurement of the variant A (the reference).</param>
+/// <param name="fn_a">The function of the variant A.</param>
+/// <param name="ctx_a">A pointer to user data passed to 'fn_a'.</param>
+/// <param name="name_b">The name of the measurement of the variant B. Must differ from 'name_a'.</param>
+/// <param name="fn_b">The function of the variant B.</param>
+/// <param name="ctx_b">A pointer to user data passed to 'fn_b'.</param>
+/// <param name="opt">The options of the run, or nullptr for the defaults. The limits apply to each variant.</param>
+/// <param name="result">Pointer to receive the result of the comparison. Can be NULL.</param>
+/// <returns>Returns VI_SUCCESS (0) on success; otherwise, returns a negative error code.</returns>
+VI_TM_API VI_TM_RESULT VI_TM_CALL vi_tmBenchAB(
+	VI_TM_HREG hreg,
+	const char *name_a,
+	vi_tmBenchFn_t fn_a,
+	void *ctx_a,
+	const char *name_b,
+	vi_tmBenchFn_t fn_b,
+	void *ctx_b,
+	const vi_tmBenchOptions_t *opt VI_DEFAULT(nullptr),
+	vi_tmBenchABResult_t *result VI_DEFAULT(nullptr)
+);
+
+/// <summary>
+/// Prints the result of vi_tmBenchAB as one line: the mean durations, the speedup with its confidence interval
+/// and the verdict: faster, slower or not significant.
+/// </summary>
+/// <param name="name_a">The name of the variant A.</param>
+/// <param name="name_b">The name of the variant B.</param>
+/// <param name="result">The result of vi_tmBenchAB.</param>
+/// <param name="cb">A callback function used to output the text.</param>
+/// <param name="ctx">A pointer to user data passed to the callback function.</param>
+/// <returns>The value returned by the callback, or a negative value if an error occurs.</returns>
+VI_TM_API VI_TM_RESULT VI_TM_CALL vi_tmBenchABReport(
+	const char *name_a,
+	const char *name_b,
+	const vi_tmBenchABResult_t *result,
+	vi_tmReportCb_t cb VI_DEFAULT(vi_tmReportCb),
+	void* ctx VI_DEFAULT(nullptr)
+);
 // Auxiliary functions: ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
 
 #define VI_STR_AUX(x) #x
@@ -541,7 +933,7 @@ VI_TM_API VI_TM_RESULT VI_TM_CALL vi_tmRegistryReport(
 #	endif
 #endif
 
-#if VI_TM_STAT_USE_RAW || VI_TM_STAT_USE_RMSE || VI_TM_STAT_USE_FILTER || VI_TM_STAT_USE_MINMAX || VI_TM_THREADSAFE || VI_TM_SHARED || VI_TM_DEBUG
+#if VI_TM_STAT_USE_RAW || VI_TM_STAT_USE_RMSE || VI_TM_STAT_USE_FILTER || VI_TM_STAT_USE_MINMAX || VI_TM_STAT_USE_CPUTIME || VI_TM_STAT_USE_PERF || VI_TM_STAT_USE_RUSAGE || VI_TM_THREADSAFE || VI_TM_SHARED || VI_TM_DEBUG
 #	if VI_TM_STAT_USE_RAW
 #		define VI_TM_S_STAT_USE_RAW "r"
 #	else
@@ -562,6 +954,21 @@ VI_TM_API VI_TM_RESULT VI_TM_CALL vi_tmRegistryReport(
 #	else
 #		define VI_TM_S_STAT_USE_MINMAX
 #	endif
+#	if VI_TM_STAT_USE_CPUTIME
+#		define VI_TM_S_STAT_USE_CPUTIME "c"
+#	else
+#		define VI_TM_S_STAT_USE_CPUTIME
+#	endif
+#	if VI_TM_STAT_USE_PERF
+#		define VI_TM_S_STAT_USE_PERF "p"
+#	else
+#		define VI_TM_S_STAT_USE_PERF
+#	endif
+#	if VI_TM_STAT_USE_RUSAGE
+#		define VI_TM_S_STAT_USE_RUSAGE "u"
+#	else
+#		define VI_TM_S_STAT_USE_RUSAGE
+#	endif
 #	if VI_TM_THREADSAFE
 #		define VI_TM_S_THREADSAFE "t"
 #	else
@@ -584,6 +991,9 @@ VI_TM_API VI_TM_RESULT VI_TM_CALL vi_tmRegistryReport(
 		VI_TM_S_STAT_USE_RMSE \
 		VI_TM_S_STAT_USE_FILTER \
 		VI_TM_S_STAT_USE_MINMAX \
+		VI_TM_S_STAT_USE_CPUTIME \
+		VI_TM_S_STAT_USE_PERF \
+		VI_TM_S_STAT_USE_RUSAGE \
 		VI_TM_S_THREADSAFE \
 		VI_TM_S_SHARED \
 		VI_TM_S_DEBUG
@@ -67,12 +67,24 @@
 #	endif
 
 #	include <cassert> // assert
+#	include <cstdint> // std::int64_t
 #	include <cstring> // std::strcmp
+#	include <functional> // std::invoke
 #	include <limits> // std::numeric_limits
+#	include <memory> // std::addressof
 #	include <optional>
 #	include <string> // std::string
 #	include <type_traits> // std::make_signed_t
 #	include <utility> // std::exchange
+#	if defined(__cpp_impl_coroutine) && defined(__has_include) && __has_include(<coroutine>)
+#		include <coroutine> // std::coroutine_handle
+#		define VI_TM_HAS_COROUTINES 1
+#	endif
+
+// Probes read thread counters besides the ticks (see scoped_probe_t::counters_t).
+#	define VI_TM_PROBE_COUNTERS (VI_TM_STAT_USE_CPUTIME || VI_TM_STAT_USE_PERF || VI_TM_STAT_USE_RUSAGE)
+
+// With VI_TM_PROBE_NESTED (see vi_timing.h) probes subtract the instrumentation cost of the probes nested in them on the same thread.
 
 namespace vi_tm
 {
@@ -101,7 +113,7 @@ namespace vi_tm
 			}
 		}
 		else
-		{	static_assert(false); // Unknown parameter type.
+		{	static_assert(sizeof(T) == 0U); // Unknown parameter type.
 			result = 1 - __LINE__;
 		}
 		
@@ -147,8 +159,44 @@ namespace vi_tm
 		//  - meas_ is a non-owning handle; caller retains ownership and must ensure validity.
 		//  - cnt_and_state_ encodes state: >0 running (count = cnt_and_state_), <0 paused (count = -cnt_and_state_), 0 idle.
 		//  - time_data_ is meaningful only when cnt_and_state_ != 0 (running or paused).
+		//  - counters_ (VI_TM_STAT_USE_CPUTIME, _PERF or _RUSAGE only) follows the same encoding as time_data_.
+		//  - nested_ (VI_TM_PROBE_NESTED only) follows the same encoding: vi_tmNestedProbes() at start, the number of nested probes while paused.
+#	if VI_TM_PROBE_COUNTERS
+		// Thread counters: the start values while running, the accumulated values while paused.
+		// Only the counters enabled in the build are read; the others stay zero.
+		struct counters_t
+		{	vi_tmCounters_t data_{};
+
+			[[nodiscard]] static counters_t now() noexcept
+			{	counters_t result;
+#		if VI_TM_STAT_USE_RUSAGE
+				(void)vi_tmRusageRead(result.data_.rusage_);
+#		endif
+#		if VI_TM_STAT_USE_PERF
+				(void)vi_tmPerfRead(result.data_.perf_);
+#		endif
+#		if VI_TM_STAT_USE_CPUTIME
+				result.data_.cpu_ = vi_tmGetThreadCpuTime();
+#		endif
+				return result;
+			}
+			counters_t& flip(const counters_t &now) noexcept // *this = now - *this
+			{	data_.cpu_ = now.data_.cpu_ - data_.cpu_;
+				for (unsigned n = 0; n < VI_TM_PERF_COUNTERS; ++n) { data_.perf_[n] = now.data_.perf_[n] - data_.perf_[n]; }
+				for (unsigned n = 0; n < VI_TM_RUSAGE_COUNTERS; ++n) { data_.rusage_[n] = now.data_.rusage_[n] - data_.rusage_[n]; }
+				return *this;
+			}
+			void add(VI_TM_HMEAS m, VI_TM_TDIFF dur, VI_TM_SIZE cnt) const noexcept { vi_tmMeasurementAddEx(m, dur, &data_, cnt); }
+		};
+#	endif
 		VI_TM_HMEAS meas_{nullptr};
 		signed_tm_size_t cnt_and_state_{0};
+#	if VI_TM_PROBE_COUNTERS
+		counters_t counters_{}; // Read before time_data_ at start and after it at stop, so the wall time does not include the counter reads.
+#	endif
+#	if VI_TM_PROBE_NESTED
+		VI_TM_SIZE nested_{ 0U };
+#	endif
 		VI_TM_TICK time_data_{VI_TM_TICK{ 0 }}; // Must be declared last - initializes after other members to minimize overhead between object construction and measurement start.
 
 		// Private constructor used by factory methods
@@ -159,8 +207,27 @@ namespace vi_tm
 		explicit scoped_probe_t(VI_TM_HMEAS m, signed_tm_size_t cnt) noexcept
 		:	meas_{ m },
 			cnt_and_state_{ cnt },
+#	if VI_TM_PROBE_COUNTERS
+			counters_{ counters_t::now() },
+#	endif
+#	if VI_TM_PROBE_NESTED
+			nested_{ vi_tmNestedProbes() },
+#	endif
 			time_data_{ vi_tmGetTicks() }
 		{/**/}
+
+		void record(VI_TM_TDIFF dur, VI_TM_SIZE cnt) const noexcept
+		{
+#	if VI_TM_PROBE_NESTED && VI_TM_PROBE_COUNTERS
+			vi_tmMeasurementAddNested(meas_, dur, nested_, &counters_.data_, cnt);
+#	elif VI_TM_PROBE_NESTED
+			vi_tmMeasurementAddNested(meas_, dur, nested_, nullptr, cnt);
+#	elif VI_TM_PROBE_COUNTERS
+			counters_.add(meas_, dur, cnt);
+#	else
+			vi_tmMeasurementAdd(meas_, dur, cnt);
+#	endif
+		}
 	public:
 		scoped_probe_t() = delete;
 		scoped_probe_t(const scoped_probe_t &) = delete;
@@ -193,6 +260,12 @@ namespace vi_tm
 		scoped_probe_t(scoped_probe_t &&s) noexcept
 		:	meas_{std::exchange(s.meas_, nullptr)},
 			cnt_and_state_{ std::exchange(s.cnt_and_state_, signed_tm_size_t{ 0 }) },
+#	if VI_TM_PROBE_COUNTERS
+			counters_{ std::exchange(s.counters_, counters_t{}) },
+#	endif
+#	if VI_TM_PROBE_NESTED
+			nested_{ std::exchange(s.nested_, VI_TM_SIZE{ 0U }) },
+#	endif
 			time_data_{std::exchange(s.time_data_, VI_TM_TICK{ 0 })}
 		{
 		}
@@ -203,6 +276,12 @@ namespace vi_tm
 				meas_ = std::exchange(s.meas_, nullptr);
 				cnt_and_state_ = std::exchange(s.cnt_and_state_, signed_tm_size_t{ 0 });
 				time_data_ = std::exchange(s.time_data_, VI_TM_TICK{ 0 });
+#	if VI_TM_PROBE_COUNTERS
+				counters_ = std::exchange(s.counters_, counters_t{});
+#	endif
+#	if VI_TM_PROBE_NESTED
+				nested_ = std::exchange(s.nested_, VI_TM_SIZE{ 0U });
+#	endif
 			}
 			return *this;
 		}
@@ -221,6 +300,12 @@ namespace vi_tm
 			assert(active());
 			if(active())
 			{	time_data_ = t - time_data_;
+#	if VI_TM_PROBE_COUNTERS
+				counters_.flip(counters_t::now());
+#	endif
+#	if VI_TM_PROBE_NESTED
+				nested_ = vi_tmNestedProbes() - nested_;
+#	endif
 				cnt_and_state_ = -cnt_and_state_;
 			}
 		}
@@ -230,6 +315,12 @@ namespace vi_tm
 		{	assert(paused());
 			if (paused())
 			{	cnt_and_state_ = -cnt_and_state_;
+#	if VI_TM_PROBE_COUNTERS
+				counters_.flip(counters_t::now());
+#	endif
+#	if VI_TM_PROBE_NESTED
+				nested_ = vi_tmNestedProbes() - nested_;
+#	endif
 				time_data_ = vi_tmGetTicks() - time_data_;
 			}
 		}
@@ -239,10 +330,17 @@ namespace vi_tm
 		{	const auto t = vi_tmGetTicks(); // Read ticks first to avoid introducing measurement overhead in conditional branch
 			assert(idle() || !!meas_);
 			if (active())
-			{	vi_tmMeasurementAdd(meas_, t - time_data_, cnt_and_state_);
+			{
+#	if VI_TM_PROBE_COUNTERS
+				counters_.flip(counters_t::now());
+#	endif
+#	if VI_TM_PROBE_NESTED
+				nested_ = vi_tmNestedProbes() - nested_;
+#	endif
+				record(t - time_data_, cnt_and_state_);
 			}
 			else if (paused())
-			{	vi_tmMeasurementAdd(meas_, time_data_, -cnt_and_state_);
+			{	record(time_data_, -cnt_and_state_);
 			}
 			cnt_and_state_ = 0; // Set idle state.
 		}
@@ -288,6 +386,160 @@ namespace vi_tm
 		[[nodiscard]] scoped_pause_t scoped_pause() noexcept { return scoped_pause_t{ *this }; }
 	}; // class scoped_probe_t
 
+#	ifdef VI_TM_HAS_COROUTINES
+/// coro_probe_t class: A RAII-style probe for coroutines that measures active and suspended time separately.
+/// Wrap each suspension point: 'co_await probe(awaitable);'. While the coroutine is suspended
+/// the active time is paused and the suspended time runs, and vice versa.
+/// The coroutine may be resumed on another thread; the probe itself must not be shared between coroutines.
+	class [[nodiscard]] coro_probe_t
+	{	scoped_probe_t active_;
+		scoped_probe_t suspended_;
+
+		template<typename T>
+		static decltype(auto) get_awaiter(T &&a)
+		{	if constexpr (requires { std::forward<T>(a).operator co_await(); })
+				return std::forward<T>(a).operator co_await();
+			else if constexpr (requires { operator co_await(std::forward<T>(a)); })
+				return operator co_await(std::forward<T>(a));
+			else
+				return std::forward<T>(a);
+		}
+
+		template<typename A>
+		class awaiter_t
+		{	coro_probe_t &probe_;
+			A awaiter_;
+
+			void suspend() noexcept { probe_.active_.pause(); probe_.suspended_.resume(); }
+			void resume() noexcept { probe_.suspended_.pause(); probe_.active_.resume(); }
+		public:
+			template<typename T>
+			awaiter_t(coro_probe_t &probe, T &&a): probe_{ probe }, awaiter_{ get_awaiter(std::forward<T>(a)) } {}
+
+			bool await_ready() { return awaiter_.await_ready(); }
+			template<typename P>
+			auto await_suspend(std::coroutine_handle<P> h)
+			{	suspend(); // Before the call: the coroutine may be resumed (even on another thread) before it returns.
+				try
+				{	return awaiter_.await_suspend(h);
+				}
+				catch (...)
+				{	resume();
+					throw;
+				}
+			}
+			decltype(auto) await_resume()
+			{	if (probe_.suspended_.active()) // Not if await_ready() returned true.
+				{	resume();
+				}
+				return awaiter_.await_resume();
+			}
+		};
+	public:
+		/// Starts the active time of 'active'. The suspended time is added to 'suspended'.
+		coro_probe_t(VI_TM_HMEAS active, VI_TM_HMEAS suspended, VI_TM_SIZE cnt = 1) noexcept
+		:	active_{ scoped_probe_t::make_running(active, cnt) },
+			suspended_{ scoped_probe_t::make_paused(suspended, cnt) }
+		{/**/}
+
+		template<typename T>
+		[[nodiscard]] auto operator()(T &&a)
+		{	using awaiter_type = decltype(get_awaiter(std::forward<T>(a)));
+			// Temporaries are moved into the wrapper; lvalue awaiters are used in place.
+			return awaiter_t<std::conditional_t<std::is_rvalue_reference_v<awaiter_type>, std::remove_cvref_t<awaiter_type>, awaiter_type>>{ *this, std::forward<T>(a) };
+		}
+	}; // class coro_probe_t
+#	endif // #ifdef VI_TM_HAS_COROUTINES
+
+/// task_meas_t: The pair of measurements of thread-pool tasks: '<name>.wait' - time spent in the queue,
+/// '<name>.run' - execution time. Create it once (e.g. as a static variable) and share it between tasks.
+	struct task_meas_t
+	{	VI_TM_HMEAS wait_;
+		VI_TM_HMEAS run_;
+		task_meas_t(VI_TM_HREG h, const char *name)
+		:	wait_{ vi_tmRegistryGetMeas(h, (std::string{ name } + ".wait").c_str()) },
+			run_{ vi_tmRegistryGetMeas(h, (std::string{ name } + ".run").c_str()) }
+		{/**/}
+	};
+
+/// timed_task_t class: A wrapper for a callable submitted to a task queue.
+/// The wait time runs from construction (enqueue) to the call (dequeue), the run time - for the duration of the call.
+/// The wrapper can be moved to and called on another thread (see vi_tmSpanBegin). It is single-shot: call it once,
+/// a second call would add one more wait measured from the same enqueue.
+	template<typename F>
+	class timed_task_t
+	{	F fn_;
+		task_meas_t meas_;
+		VI_TM_SPAN enqueued_;
+	public:
+		timed_task_t(const task_meas_t &meas, F fn)
+		:	fn_{ std::move(fn) },
+			meas_{ meas },
+			enqueued_{ vi_tmSpanBegin() } // Last, so that the copying of the callable is not counted.
+		{/**/}
+
+		template<typename... Args>
+		decltype(auto) operator()(Args&&... args)
+		{	// One tick read ends the wait and starts the run; both are recorded after the call (also on exception).
+			struct finisher_t
+			{	const task_meas_t &meas_;
+				const VI_TM_TICK enqueued_;
+				const VI_TM_TICK started_ = vi_tmGetTicks();
+				~finisher_t()
+				{	const auto finished = vi_tmGetTicks();
+					const auto wait = started_ - enqueued_; // Ticks of two threads: negative if their clocks differ, as in vi_tmSpanEnd.
+					vi_tmMeasurementAdd(meas_.wait_, static_cast<std::int64_t>(wait) < 0 ? VI_TM_TDIFF{} : wait);
+					vi_tmMeasurementAdd(meas_.run_, finished - started_);
+				}
+			} const finisher{ meas_, enqueued_ };
+			return std::invoke(fn_, std::forward<Args>(args)...);
+		}
+	};
+
+	template<typename F>
+	[[nodiscard]] timed_task_t<std::decay_t<F>> make_timed_task(const task_meas_t &meas, F &&fn)
+	{	return { meas, std::forward<F>(fn) };
+	}
+
+/// bench: Runs a micro-benchmark of the callable and adds it to the measurement 'name' (see vi_tmBench).
+/// Exceptions thrown by the callable are propagated.
+	template<typename F>
+	vi_tmBenchResult_t bench(const char *name, F &&fn, const vi_tmBenchOptions_t &opt = {}, VI_TM_HREG reg = VI_TM_HGLOBAL)
+	{	using fn_t = std::remove_reference_t<F>;
+		vi_tmBenchResult_t result{};
+		[[maybe_unused]] const auto ret = vi_tmBench
+		(	reg,
+			name,
+			[](void *ctx) { std::invoke(*static_cast<fn_t *>(ctx)); },
+			const_cast<void *>(static_cast<const void *>(std::addressof(fn))),
+			&opt,
+			&result
+		);
+		assert(VI_SUCCEEDED(ret));
+		return result;
+	}
+
+/// bench_ab: Compares two callables with interleaved batches and Welch's t-test (see vi_tmBenchAB, vi_tmBenchABReport).
+	template<typename FA, typename FB>
+	vi_tmBenchABResult_t bench_ab(const char *name_a, FA &&fn_a, const char *name_b, FB &&fn_b, const vi_tmBenchOptions_t &opt = {}, VI_TM_HREG reg = VI_TM_HGLOBAL)
+	{	using fa_t = std::remove_reference_t<FA>;
+		using fb_t = std::remove_reference_t<FB>;
+		vi_tmBenchABResult_t result{};
+		[[maybe_unused]] const auto ret = vi_tmBenchAB
+		(	reg,
+			name_a,
+			[](void *ctx) { std::invoke(*static_cast<fa_t *>(ctx)); },
+			const_cast<void *>(static_cast<const void *>(std::addressof(fn_a))),
+			name_b,
+			[](void *ctx) { std::invoke(*static_cast<fb_t *>(ctx)); },
+			const_cast<void *>(static_cast<const void *>(std::addressof(fn_b))),
+			&opt,
+			&result
+		);
+		assert(VI_SUCCEEDED(ret));
+		return result;
+	}
+
 	[[nodiscard]] inline std::string to_string(double val, unsigned char sig = 2U, unsigned char dec = 1U)
 	{	std::string result;
 		result.resize(sig + (9 + 1 + 1), '\0'); // "-00S.Se-308"
@@ -0,0 +1,102 @@
+/*****************************************************************************\
+* This file is part of the vi_timing library.
+*
+* vi_timing - a compact, lightweight C/C++ library for measuring code
+* execution time. It was developed for experimental and educational purposes,
+* so please keep expectations reasonable.
+*
+* Report bugs or suggest improvements to author: <programmer.amateur@proton.me>
+*
+* LICENSE & DISCLAIMER:
+* - No warranties. Use at your own risk.
+* - Licensed under Business Source License 1.1 (BSL-1.1):
+*   - Free for non-commercial use.
+*   - For commercial licensing, contact the author.
+*   - Change Date: 2029-09-01 - after which the library will be licensed
+*     under GNU GPLv3.
+*   - Attribution required: "vi_timing Library (c) A.Prograamar".
+*   - See LICENSE in the project root for full terms.
+\*****************************************************************************/
+
+/*****************************************************************************\
+* This header describes the live statistics page: a shared-memory file
+* (e.g. /dev/shm/<name>) into which a registry mirrors every measurement.
+*
+* The page consists of a vi_tmShmHeader_t followed by 'capacity_' slots.
+* Each slot is protected by a sequence counter (seqlock): the writer makes
+* the counter odd, updates the statistics and makes it even again.
+* Writers never wait for readers; a reader retries if the counter was odd
+* or changed while the slot was being copied (see vi_tmShmSlotLoad).
+*
+* Available on POSIX systems only.
+\*****************************************************************************/
+
+#ifndef VI_TIMING_VI_TM_SHM_H
+#	define VI_TIMING_VI_TM_SHM_H
+#	pragma once
+
+#	include <vi_timing/vi_timing.h>
+
+#define VI_TM_SHM_MAGIC (0x004D48534D544956ULL) // "VITMSHM\0" in little-endian byte order.
+#define VI_TM_SHM_VERSION (1U) // Layout version of the page.
+#define VI_TM_SHM_NAME_SIZE (128U) // Size of the name field in a slot, including null-terminator.
+#define VI_TM_SHM_MAX_RETRIES (65536) // vi_tmShmSlotLoad gives up after so many attempts (each yields the thread).
+#define VI_TM_SHM_LAYOUT_FLAGS (vi_tmStatUseBase | vi_tmStatUseRMSE | vi_tmStatUseMinMax | vi_tmStatUseCpuTime | vi_tmStatUsePerf | vi_tmStatUseRusage) // vi_tmStatus_e bits that change the layout of vi_tmStats_t.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#pragma pack(push, 16)
+// vi_tmShmHeader_t: Header at the beginning of the live statistics page.
+typedef struct vi_tmShmHeader_t
+{	uint64_t magic_;			// VI_TM_SHM_MAGIC. Written after the rest of the header is initialized.
+	uint32_t version_;			// VI_TM_SHM_VERSION.
+	uint32_t flags_;			// vi_tmInfoFlags of the writer; the layout of vi_tmStats_t depends on it.
+	uint32_t slot_size_;		// sizeof(vi_tmShmSlot_t) of the writer.
+	uint32_t capacity_;			// Number of slots following the header.
+	uint32_t count_;			// Number of slots in use. It only grows; slots below it have their names set.
+	uint32_t pid_;				// Process ID of the writer.
+	VI_TM_FP seconds_per_tick_;	// Duration of one tick in seconds.
+	VI_TM_FP overhead_ticks_;	// Clock overhead in ticks (subtracted once per call in reports).
+} vi_tmShmHeader_t;
+
+// vi_tmShmSlot_t: Mirror of a single measurement.
+typedef struct vi_tmShmSlot_t
+{	uint64_t seq_;						// Sequence counter. Odd while the writer is updating 'stats_'.
+	char name_[VI_TM_SHM_NAME_SIZE];	// Measurement name, truncated if necessary.
+	vi_tmStats_t stats_;				// Copy of the measurement statistics.
+} vi_tmShmSlot_t;
+#pragma pack(pop)
+
+/// <summary>
+/// Starts (or stops) mirroring all measurements of the registry into a shared-memory page.
+/// </summary>
+/// <param name="hreg">The handle to the registry to mirror.</param>
+/// <param name="name">Name of the page (as for shm_open, e.g. "vi_tm_1234" - /dev/shm/vi_tm_1234 on Linux).
+/// If NULL, mirroring is stopped and the page is removed.</param>
+/// <param name="capacity">Maximum number of measurements in the page. Measurements beyond it are not mirrored.</param>
+/// <returns>Returns VI_SUCCESS (0) on success; otherwise, returns a negative error code.
+/// Fails if a page with this name exists and its writer (this process included) is alive; a page left by an exited
+/// process is replaced.</returns>
+VI_TM_API VI_TM_RESULT VI_TM_CALL vi_tmRegistryMirror(
+	VI_TM_HREG hreg,
+	const char *name,
+	VI_TM_SIZE capacity VI_DEFAULT(4096)
+);
+
+/// <summary>
+/// Reads a consistent copy of the statistics from a slot of the live statistics page.
+/// Retries while the writer is updating the slot, at most VI_TM_SHM_MAX_RETRIES times.
+/// </summary>
+/// <param name="slot">Pointer to the slot (usually in a read-only mapping of the page).</param>
+/// <param name="dst">Pointer to the structure that receives the statistics. Its content is undefined on failure.</param>
+/// <returns>The number of retries caused by concurrent updates, or a negative error code: e.g. the slot stayed locked
+/// because the writer died in the middle of an update.</returns>
+VI_TM_API VI_TM_RESULT VI_TM_CALL vi_tmShmSlotLoad(const vi_tmShmSlot_t *slot, vi_tmStats_t *dst) VI_NOEXCEPT;
+
+#ifdef __cplusplus
+} // extern "C" {
+#endif
+
+#endif // #ifndef VI_TIMING_VI_TM_SHM_H
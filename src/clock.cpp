@@ -174,3 +174,26 @@
 #else
 #	error "You need to define function(s) for your OS and CPU"
 #endif
+
+#if defined(_WIN32)
+#	include <Windows.h>
+	VI_TM_TICK VI_TM_CALL vi_tmGetThreadCpuTime(void) noexcept
+	{	FILETIME creation, exit, kernel, user;
+		if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+		{	assert(false);
+			return 0U;
+		}
+		const auto to_u64 = [](const FILETIME &ft) { return (static_cast<VI_TM_TICK>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime; };
+		return 100U * (to_u64(kernel) + to_u64(user)); // FILETIME is in 100-nanosecond intervals.
+	}
+#else
+#	include <time.h>
+	VI_TM_TICK VI_TM_CALL vi_tmGetThreadCpuTime(void) noexcept
+	{	struct timespec ts;
+		if (0 != clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts))
+		{	assert(false);
+			return 0U;
+		}
+		return 1'000'000'000U * ts.tv_sec + ts.tv_nsec;
+	}
+#endif
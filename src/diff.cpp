@@ -0,0 +1,324 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+/*****************************************************************************\
+* This file is part of the vi_timing library.
+* 
+* vi_timing - a compact, lightweight C/C++ library for measuring code 
+* execution time. It was developed for experimental and educational purposes, 
+* so please keep expectations reasonable.
+*
+* Report bugs or suggest improvements to author: <programmer.amateur@proton.me>
+*
+* LICENSE & DISCLAIMER:
+* - No warranties. Use at your own risk.
+* - Licensed under Business Source License 1.1 (BSL-1.1):
+*   - Free for non-commercial use.
+*   - For commercial licensing, contact the author.
+*   - Change Date: 2029-09-01 - after which the library will be licensed 
+*     under GNU GPLv3.
+*   - Attribution required: "vi_timing Library (c) A.Prograamar".
+*   - See LICENSE in the project root for full terms.
+\*****************************************************************************/
+
+
+#include "build_number_generator.h"
+#include "misc.h"
+#include <vi_timing/vi_timing.h>
+
+#include <algorithm>
+#include <cassert>
+#include <charconv> // For std::from_chars
+#include <cmath>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std::literals;
+
+namespace
+{
+	constexpr auto NaN = std::numeric_limits<double>::quiet_NaN();
+
+	// row_t: The values of one measurement of a snapshot that the comparison needs. NaN - not available.
+	struct row_t
+	{	std::string name_;
+		double mean_ = NaN; // Seconds per event.
+		double stddev_ = NaN; // Seconds.
+		double calls_ = NaN; // Number of calls behind the mean: the sample size of the test.
+		double cnt_ = NaN; // Number of events behind the mean and the standard deviation.
+	};
+
+	// Splits a CSV line (RFC 4180, as written by vi_tmRegistryExport) into fields.
+	bool split(std::string_view line, std::vector<std::string> &fields)
+	{	fields.clear();
+		std::size_t pos = 0U;
+		do
+		{	auto &f = fields.emplace_back();
+			if (pos < line.size() && '"' == line[pos])
+			{	for (++pos;; ++pos)
+				{	if (pos >= line.size())
+					{	return false; // Unterminated quoted field.
+					}
+					if ('"' == line[pos])
+					{	if (pos + 1U < line.size() && '"' == line[pos + 1U])
+						{	++pos; // A doubled quote.
+						}
+						else
+						{	++pos;
+							break;
+						}
+					}
+					f += line[pos];
+				}
+				if (pos < line.size() && ',' != line[pos])
+				{	return false;
+				}
+			}
+			else
+			{	const auto end = std::min(line.find(',', pos), line.size());
+				f.assign(line.substr(pos, end - pos));
+				pos = end;
+			}
+		} while (pos++ < line.size());
+		return true;
+	}
+
+	double to_double(const std::string &s)
+	{	double result = NaN;
+		if (!s.empty())
+		{	const auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), result);
+			if (std::errc{} != ec || ptr != s.data() + s.size())
+			{	result = NaN;
+			}
+		}
+		return result;
+	}
+
+	// Parses a snapshot: the CSV export of a registry (see vi_tmExportCsv). Returns false if the text is malformed.
+	bool parse(std::string_view text, std::vector<row_t> &rows)
+	{	std::vector<std::string> fields;
+		constexpr auto npos = std::string_view::npos;
+		std::size_t name_idx = npos;
+		std::size_t mean_idx = npos;
+		std::size_t stddev_idx = npos;
+		std::size_t calls_idx = npos;
+		std::size_t cnt_idx = npos;
+		std::size_t width = 0U;
+		for (std::size_t pos = 0U; pos < text.size();)
+		{	auto end = std::min(text.find('\n', pos), text.size());
+			auto line = text.substr(pos, end - pos);
+			pos = end + 1U;
+			if (!line.empty() && '\r' == line.back())
+			{	line.remove_suffix(1U);
+			}
+			if (line.empty())
+			{	continue;
+			}
+			if (!split(line, fields))
+			{	return false;
+			}
+
+			if (0U == width) // The header.
+			{	width = fields.size();
+				for (std::size_t n = 0; n < fields.size(); ++n)
+				{	const auto &f = fields[n];
+					if ("name"sv == f)
+					{	name_idx = n;
+					}
+					else if ("mean"sv == f)
+					{	mean_idx = n;
+					}
+					else if ("stddev"sv == f)
+					{	stddev_idx = n;
+					}
+					else if ("filtered_calls"sv == f || ("calls"sv == f && npos == calls_idx)) // The filtered calls are preferred.
+					{	calls_idx = n;
+					}
+					else if ("filtered_count"sv == f || ("count"sv == f && npos == cnt_idx)) // The filtered count is preferred.
+					{	cnt_idx = n;
+					}
+				}
+				if (npos == name_idx || npos == mean_idx)
+				{	return false;
+				}
+				continue;
+			}
+
+			if (fields.size() != width)
+			{	return false;
+			}
+			auto &r = rows.emplace_back();
+			r.name_ = std::move(fields[name_idx]);
+			r.mean_ = to_double(fields[mean_idx]);
+			r.stddev_ = npos == stddev_idx ? NaN : to_double(fields[stddev_idx]);
+			r.calls_ = npos == calls_idx ? NaN : to_double(fields[calls_idx]);
+			r.cnt_ = npos == cnt_idx ? NaN : to_double(fields[cnt_idx]);
+		}
+		return 0U != width;
+	}
+
+	enum class verdict_t { same, regressed, improved, added, missing, unknown };
+
+	struct diff_t
+	{	std::string_view name_;
+		const row_t *base_ = nullptr;
+		const row_t *curr_ = nullptr;
+		double change_ = NaN; // Relative change of the mean.
+		double t_ = NaN; // Welch's t statistic; NaN - the variance is unknown.
+		verdict_t verdict_ = verdict_t::unknown;
+	};
+
+	// The squared standard error of the mean. The samples are the calls, each one is the mean of cnt_/calls_
+	// events, as in mean_and_se2() of props.cpp: se2 = ss / (cnt/calls) / (calls - 1) / calls, ss = stddev2 * (cnt - 1).
+	double se2(const row_t &r)
+	{	const auto cnt = std::isfinite(r.cnt_) ? r.cnt_ : r.calls_;
+		return r.stddev_ * r.stddev_ * (cnt - 1.0) / cnt / (r.calls_ - 1.0);
+	}
+
+	diff_t compare(const row_t *base, const row_t *curr, double threshold)
+	{	diff_t result{ base ? std::string_view{ base->name_ } : std::string_view{ curr->name_ }, base, curr };
+		if (!base)
+		{	result.verdict_ = verdict_t::added;
+		}
+		else if (!curr)
+		{	result.verdict_ = verdict_t::missing;
+		}
+		else if (base->mean_ > 0.0 && std::isfinite(curr->mean_))
+		{	result.change_ = curr->mean_ / base->mean_ - 1.0;
+			bool significant = true; // Without the variance only the threshold is checked.
+			if (base->calls_ >= 2.0 && curr->calls_ >= 2.0 && std::isfinite(base->stddev_) && std::isfinite(curr->stddev_))
+			{	const auto [t, df] = misc::welch
+				(	curr->mean_, se2(*curr), curr->calls_,
+					base->mean_, se2(*base), base->calls_
+				);
+				result.t_ = t;
+				significant = df > 0.0 && std::abs(t) > misc::t_quantile_95(df);
+			}
+
+			if (significant && result.change_ > threshold)
+			{	result.verdict_ = verdict_t::regressed;
+			}
+			else if (significant && result.change_ < -threshold)
+			{	result.verdict_ = verdict_t::improved;
+			}
+			else
+			{	result.verdict_ = verdict_t::same;
+			}
+		}
+		return result;
+	}
+
+	std::string_view to_string(verdict_t v) noexcept
+	{	switch (v)
+		{
+		case verdict_t::same: return "ok"sv;
+		case verdict_t::regressed: return "REGRESSED"sv;
+		case verdict_t::improved: return "improved"sv;
+		case verdict_t::added: return "new"sv;
+		case verdict_t::missing: return "missing"sv;
+		default: return "n/a"sv;
+		}
+	}
+
+	std::string seconds_txt(const row_t *r)
+	{	return (r && std::isfinite(r->mean_)) ? misc::to_string(r->mean_, 2, 1) + 's' : "-"s;
+	}
+
+	// Formats a value with one decimal and an optional sign: "+12.3".
+	std::string fixed_txt(double v, bool sign)
+	{	if (!std::isfinite(v))
+		{	return "-"s;
+		}
+		char str[32];
+		const auto [end, ec] = std::to_chars(std::begin(str), std::end(str), std::round(v * 10.0) / 10.0, std::chars_format::fixed, 1);
+		assert(std::errc{} == ec);
+		return (sign && v >= 0.0 ? "+"s : ""s) + std::string{ str, end };
+	}
+} // namespace
+
+VI_TM_RESULT VI_TM_CALL vi_tmSnapshotDiff(const char *base, const char *curr, double threshold, vi_tmReportCb_t fn, void *ctx)
+{	if (!verify(!!base && !!curr && !!fn) || !(threshold >= 0.0))
+	{	return VI_FAILURE;
+	}
+
+	std::vector<row_t> base_rows;
+	std::vector<row_t> curr_rows;
+	if (!parse(base, base_rows) || !parse(curr, curr_rows))
+	{	return VI_FAILURE;
+	}
+
+	const auto by_name = [](const row_t &l, const row_t &r) { return l.name_ < r.name_; };
+	std::sort(base_rows.begin(), base_rows.end(), by_name);
+	std::sort(curr_rows.begin(), curr_rows.end(), by_name);
+
+	std::vector<diff_t> diffs;
+	diffs.reserve(std::max(base_rows.size(), curr_rows.size()));
+	for (auto b = base_rows.cbegin(), c = curr_rows.cbegin(); b != base_rows.cend() || c != curr_rows.cend();)
+	{	if (c == curr_rows.cend() || (b != base_rows.cend() && b->name_ < c->name_))
+		{	diffs.push_back(compare(&*b++, nullptr, threshold));
+		}
+		else if (b == base_rows.cend() || c->name_ < b->name_)
+		{	diffs.push_back(compare(nullptr, &*c++, threshold));
+		}
+		else
+		{	diffs.push_back(compare(&*b++, &*c++, threshold));
+		}
+	}
+
+	struct text_t
+	{	std::string_view name_;
+		std::string base_;
+		std::string curr_;
+		std::string change_;
+		std::string t_;
+		std::string_view verdict_;
+	};
+	std::vector<text_t> lines;
+	lines.reserve(diffs.size() + 1U);
+	lines.push_back({ "Name"sv, "Base"s, "Current"s, "Change"s, "t"s, "Verdict"sv });
+	for (const auto &d : diffs)
+	{	lines.push_back
+		({	d.name_,
+			seconds_txt(d.base_),
+			seconds_txt(d.curr_),
+			std::isfinite(d.change_) ? fixed_txt(d.change_ * 100.0, true) + '%' : "-"s,
+			fixed_txt(d.t_, false),
+			to_string(d.verdict_)
+		});
+	}
+
+	std::size_t widths[5]{};
+	for (const auto &l : lines)
+	{	widths[0] = std::max(widths[0], l.name_.size());
+		widths[1] = std::max(widths[1], l.base_.size());
+		widths[2] = std::max(widths[2], l.curr_.size());
+		widths[3] = std::max(widths[3], l.change_.size());
+		widths[4] = std::max(widths[4], l.t_.size());
+	}
+
+	const auto prn = [fn, ctx](const char *str) { return fn(str, ctx); };
+	misc::writer_t w{ prn };
+	w.put("Threshold: "sv);
+	w.put(fixed_txt(threshold * 100.0, false));
+	w.put("%."sv);
+	w.end_line();
+	for (const auto &l : lines)
+	{	w.left(l.name_, widths[0]);
+		w.put(": "sv);
+		w.right(l.base_, widths[1]);
+		w.put(" -> "sv);
+		w.right(l.curr_, widths[2]);
+		w.put("  "sv);
+		w.right(l.change_, widths[3]);
+		w.put("  "sv);
+		w.right(l.t_, widths[4]);
+		w.put("  "sv);
+		w.put(l.verdict_);
+		w.end_line();
+	}
+	w.flush();
+
+	return static_cast<VI_TM_RESULT>(std::count_if(diffs.begin(), diffs.end(), [](const diff_t &d) { return verdict_t::regressed == d.verdict_; }));
+}
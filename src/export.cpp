@@ -0,0 +1,315 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+/*****************************************************************************\
+* This file is part of the vi_timing library.
+* 
+* vi_timing - a compact, lightweight C/C++ library for measuring code 
+* execution time. It was developed for experimental and educational purposes, 
+* so please keep expectations reasonable.
+*
+* Report bugs or suggest improvements to author: <programmer.amateur@proton.me>
+*
+* LICENSE & DISCLAIMER:
+* - No warranties. Use at your own risk.
+* - Licensed under Business Source License 1.1 (BSL-1.1):
+*   - Free for non-commercial use.
+*   - For commercial licensing, contact the author.
+*   - Change Date: 2029-09-01 - after which the library will be licensed 
+*     under GNU GPLv3.
+*   - Attribution required: "vi_timing Library (c) A.Prograamar".
+*   - See LICENSE in the project root for full terms.
+\*****************************************************************************/
+
+#include "build_number_generator.h"
+#include "misc.h"
+#include <vi_timing/vi_timing.h>
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+using namespace std::literals;
+
+namespace
+{
+	struct entry_t
+	{	std::string name_; // A copy: the registry entry may be removed once the enumeration ends.
+		vi_tmStats_t stats_;
+	};
+
+	struct context_t
+	{	double seconds_per_tick_;
+		double overhead_ticks_; // Subtracted once per call, as in the report.
+	};
+
+	using value_t = std::variant<std::uint64_t, double>; // NaN - the value is not available.
+
+	struct column_t
+	{	std::string_view name_; // JSON key and CSV header.
+		std::string_view metric_; // Prometheus metric name.
+		std::string_view type_; // Prometheus metric type.
+		std::string_view help_;
+		value_t (*get_)(const vi_tmStats_t &, const context_t &);
+	};
+
+	constexpr auto NaN = std::numeric_limits<double>::quiet_NaN();
+
+	const column_t columns[]
+	{	{	"calls"sv, "vi_tm_calls_total"sv, "counter"sv, "Number of measurement calls."sv,
+			[](const vi_tmStats_t &s, const context_t &) -> value_t { return std::uint64_t{ s.calls_ }; }
+		},
+#if VI_TM_STAT_USE_RAW
+		{	"count"sv, "vi_tm_events_total"sv, "counter"sv, "Number of measured events."sv,
+			[](const vi_tmStats_t &s, const context_t &) -> value_t { return std::uint64_t{ s.cnt_ }; }
+		},
+		{	"ticks"sv, "vi_tm_ticks_total"sv, "counter"sv, "Measured time in clock ticks, as recorded."sv,
+			[](const vi_tmStats_t &s, const context_t &) -> value_t { return std::uint64_t{ s.sum_ }; }
+		},
+		// A gauge, not a counter: the subtracted overhead grows with the calls, so the value may decrease.
+		{	"seconds"sv, "vi_tm_seconds"sv, "gauge"sv, "Measured time in seconds, corrected for the clock overhead."sv,
+			[](const vi_tmStats_t &s, const context_t &c) -> value_t
+			{	return (static_cast<double>(s.sum_) - c.overhead_ticks_ * static_cast<double>(s.calls_)) * c.seconds_per_tick_;
+			}
+		},
+#endif
+#if VI_TM_STAT_USE_RMSE
+		{	"filtered_calls"sv, "vi_tm_filtered_calls_total"sv, "counter"sv, "Number of calls accepted by the outlier filter."sv,
+			[](const vi_tmStats_t &s, const context_t &) -> value_t { return std::uint64_t{ s.flt_calls_ }; }
+		},
+		{	"filtered_count"sv, "vi_tm_filtered_events_total"sv, "counter"sv, "Number of events accepted by the outlier filter."sv,
+			[](const vi_tmStats_t &s, const context_t &) -> value_t { return static_cast<double>(s.flt_cnt_); }
+		},
+		{	"mean"sv, "vi_tm_mean_seconds"sv, "gauge"sv, "Mean time of an event in seconds, corrected for the clock overhead."sv,
+			[](const vi_tmStats_t &s, const context_t &c) -> value_t
+			{	return s.flt_cnt_ > 0.0 ? (s.flt_avg_ - c.overhead_ticks_) * c.seconds_per_tick_ : NaN;
+			}
+		},
+		{	"stddev"sv, "vi_tm_stddev_seconds"sv, "gauge"sv, "Standard deviation of the time of an event in seconds."sv,
+			[](const vi_tmStats_t &s, const context_t &c) -> value_t
+			{	return s.flt_cnt_ > 1.0 ? std::sqrt(s.flt_ss_ / (s.flt_cnt_ - 1.0)) * c.seconds_per_tick_ : NaN;
+			}
+		},
+#elif VI_TM_STAT_USE_RAW
+		{	"mean"sv, "vi_tm_mean_seconds"sv, "gauge"sv, "Mean time of an event in seconds, corrected for the clock overhead."sv,
+			[](const vi_tmStats_t &s, const context_t &c) -> value_t
+			{	return 0U != s.cnt_ ?
+					(static_cast<double>(s.sum_) - c.overhead_ticks_ * static_cast<double>(s.calls_)) * c.seconds_per_tick_ / static_cast<double>(s.cnt_) :
+					NaN;
+			}
+		},
+#endif
+#if VI_TM_STAT_USE_MINMAX
+		{	"min"sv, "vi_tm_min_seconds"sv, "gauge"sv, "Minimum time of an event in seconds, corrected for the clock overhead."sv,
+			[](const vi_tmStats_t &s, const context_t &c) -> value_t
+			{	return 0U != s.calls_ ? (s.min_ - c.overhead_ticks_) * c.seconds_per_tick_ : NaN;
+			}
+		},
+		{	"max"sv, "vi_tm_max_seconds"sv, "gauge"sv, "Maximum time of an event in seconds, corrected for the clock overhead."sv,
+			[](const vi_tmStats_t &s, const context_t &c) -> value_t
+			{	return 0U != s.calls_ ? (s.max_ - c.overhead_ticks_) * c.seconds_per_tick_ : NaN;
+			}
+		},
+#endif
+#if VI_TM_STAT_USE_CPUTIME
+		{	"cpu_seconds"sv, "vi_tm_cpu_seconds_total"sv, "counter"sv, "Thread CPU time of the measured intervals in seconds."sv,
+			[](const vi_tmStats_t &s, const context_t &) -> value_t { return static_cast<double>(s.cpu_) * 1e-9; }
+		},
+#endif
+#if VI_TM_STAT_USE_PERF // The meaning of the counters depends on the PMU: see vi_tmPerfCounterName().
+		{	"perf0"sv, "vi_tm_perf0_total"sv, "counter"sv, "perf_event counter 0: instructions, or task-clock nanoseconds without a hardware PMU."sv,
+			[](const vi_tmStats_t &s, const context_t &) -> value_t { return std::uint64_t{ s.perf_[0] }; }
+		},
+		{	"perf1"sv, "vi_tm_perf1_total"sv, "counter"sv, "perf_event counter 1: cycles, or page faults without a hardware PMU."sv,
+			[](const vi_tmStats_t &s, const context_t &) -> value_t { return std::uint64_t{ s.perf_[1] }; }
+		},
+		{	"perf2"sv, "vi_tm_perf2_total"sv, "counter"sv, "perf_event counter 2: LLC misses, or context switches without a hardware PMU."sv,
+			[](const vi_tmStats_t &s, const context_t &) -> value_t { return std::uint64_t{ s.perf_[2] }; }
+		},
+		{	"perf3"sv, "vi_tm_perf3_total"sv, "counter"sv, "perf_event counter 3: branch misses, or CPU migrations without a hardware PMU."sv,
+			[](const vi_tmStats_t &s, const context_t &) -> value_t { return std::uint64_t{ s.perf_[3] }; }
+		},
+#endif
+#if VI_TM_STAT_USE_RUSAGE
+		{	"voluntary_switches"sv, "vi_tm_voluntary_context_switches_total"sv, "counter"sv, "Voluntary context switches (blocking) in the measured intervals."sv,
+			[](const vi_tmStats_t &s, const context_t &) -> value_t { return std::uint64_t{ s.rusage_[0] }; }
+		},
+		{	"involuntary_switches"sv, "vi_tm_involuntary_context_switches_total"sv, "counter"sv, "Involuntary context switches (preemption) in the measured intervals."sv,
+			[](const vi_tmStats_t &s, const context_t &) -> value_t { return std::uint64_t{ s.rusage_[1] }; }
+		},
+		{	"minor_faults"sv, "vi_tm_minor_page_faults_total"sv, "counter"sv, "Minor page faults in the measured intervals."sv,
+			[](const vi_tmStats_t &s, const context_t &) -> value_t { return std::uint64_t{ s.rusage_[2] }; }
+		},
+		{	"major_faults"sv, "vi_tm_major_page_faults_total"sv, "counter"sv, "Major page faults (disk I/O) in the measured intervals."sv,
+			[](const vi_tmStats_t &s, const context_t &) -> value_t { return std::uint64_t{ s.rusage_[3] }; }
+		},
+#endif
+	};
+
+	// Copies names and statistics of all measurements under the registry lock; the formatting is done outside of it.
+	std::vector<entry_t> snapshot(VI_TM_HREG registry_handle)
+	{	std::vector<entry_t> result;
+		vi_tmRegistryEnumerateMeas
+		(	registry_handle,
+			[](VI_TM_HMEAS h, void *callback_data)
+			{	auto &v = *static_cast<std::vector<entry_t> *>(callback_data); // The pointer to void is necessary for C compatibility.
+				const char *name;
+				auto &e = v.emplace_back();
+				vi_tmMeasurementGet(h, &name, &e.stats_);
+				e.name_ = name;
+				return 0; // Ok, continue enumerate.
+			},
+			&result
+		);
+		return result;
+	}
+
+	// Writes a value; 'nan' is written instead of NaN and infinite values.
+	template<typename F>
+	void put_value(misc::writer_t<F> &w, const value_t &v, std::string_view nan)
+	{	if (const auto u = std::get_if<std::uint64_t>(&v))
+		{	w.put_num(*u);
+		}
+		else if (const auto d = std::get<double>(v); std::isfinite(d))
+		{	w.put_num(d);
+		}
+		else
+		{	w.put(nan);
+		}
+	}
+
+	template<typename F>
+	void put_json_string(misc::writer_t<F> &w, std::string_view s)
+	{	w.put('"');
+		for (const char c : s)
+		{	if ('"' == c || '\\' == c)
+			{	w.put('\\');
+				w.put(c);
+			}
+			else if (static_cast<unsigned char>(c) < 0x20U)
+			{	constexpr char hex[] = "0123456789abcdef";
+				w.put("\\u00"sv);
+				w.put(hex[(c >> 4) & 0x0F]);
+				w.put(hex[c & 0x0F]);
+			}
+			else
+			{	w.put(c);
+			}
+		}
+		w.put('"');
+	}
+
+	template<typename F>
+	void export_json(misc::writer_t<F> &w, const std::vector<entry_t> &entries, const context_t &ctx)
+	{	w.put("{\"seconds_per_tick\":"sv);
+		w.put_num(ctx.seconds_per_tick_);
+		w.put(",\"overhead_ticks\":"sv);
+		w.put_num(ctx.overhead_ticks_);
+		w.put(",\"measurements\":["sv);
+		w.end_line();
+		for (std::size_t n = 0; n < entries.size(); ++n)
+		{	const auto &e = entries[n];
+			w.put("{\"name\":"sv);
+			put_json_string(w, e.name_);
+			for (const auto &c : columns)
+			{	w.put(",\""sv);
+				w.put(c.name_);
+				w.put("\":"sv);
+				put_value(w, c.get_(e.stats_, ctx), "null"sv);
+			}
+			w.put(n + 1U < entries.size() ? "},"sv : "}"sv);
+			w.end_line();
+		}
+		w.put("]}"sv);
+		w.end_line();
+	}
+
+	template<typename F>
+	void export_csv(misc::writer_t<F> &w, const std::vector<entry_t> &entries, const context_t &ctx)
+	{	w.put("name"sv);
+		for (const auto &c : columns)
+		{	w.put(',');
+			w.put(c.name_);
+		}
+		w.end_line();
+
+		for (const auto &e : entries)
+		{	w.put('"');
+			for (const char c : e.name_)
+			{	w.put(c, '"' == c ? 2U : 1U); // RFC 4180: a quote inside a quoted field is doubled.
+			}
+			w.put('"');
+			for (const auto &c : columns)
+			{	w.put(',');
+				put_value(w, c.get_(e.stats_, ctx), ""sv);
+			}
+			w.end_line();
+		}
+	}
+
+	template<typename F>
+	void export_prometheus(misc::writer_t<F> &w, const std::vector<entry_t> &entries, const context_t &ctx)
+	{	// Text exposition format: all samples of a metric follow its HELP and TYPE lines.
+		for (const auto &c : columns)
+		{	w.put("# HELP "sv);
+			w.put(c.metric_);
+			w.put(' ');
+			w.put(c.help_);
+			w.end_line();
+			w.put("# TYPE "sv);
+			w.put(c.metric_);
+			w.put(' ');
+			w.put(c.type_);
+			w.end_line();
+
+			for (const auto &e : entries)
+			{	w.put(c.metric_);
+				w.put("{name=\""sv);
+				for (const char ch : e.name_)
+				{	switch (ch)
+					{	case '\\': w.put("\\\\"sv); break;
+						case '"': w.put("\\\""sv); break;
+						case '\n': w.put("\\n"sv); break;
+						default: w.put(ch); break;
+					}
+				}
+				w.put("\"} "sv);
+				put_value(w, c.get_(e.stats_, ctx), "NaN"sv);
+				w.end_line();
+			}
+		}
+	}
+} // namespace
+
+VI_TM_RESULT VI_TM_CALL vi_tmRegistryExport(VI_TM_HREG registry_handle, vi_tmExportFormat_e format, vi_tmReportCb_t fn, void *ctx)
+{	if (!verify(nullptr != fn))
+	{	return VI_FAILURE;
+	}
+
+	const auto entries = snapshot(registry_handle);
+	const auto &props = misc::properties_t::props();
+	const context_t context{ props.seconds_per_tick_.count(), props.clock_overhead_ticks_ };
+	const auto prn = [fn, ctx](const char *str) { return fn(str, ctx); };
+	misc::writer_t w{ prn };
+	switch (format)
+	{
+	case vi_tmExportJson:
+		export_json(w, entries, context);
+		break;
+	case vi_tmExportCsv:
+		export_csv(w, entries, context);
+		break;
+	case vi_tmExportPrometheus:
+		export_prometheus(w, entries, context);
+		break;
+	default:
+		assert(false);
+		return VI_FAILURE;
+	}
+	return w.flush();
+}
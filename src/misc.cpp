@@ -40,6 +40,8 @@
 #include <cassert>
 #include <cerrno>
 #include <cfloat>
+#include <climits> // For UCHAR_MAX
+#include <charconv> // For std::to_chars
 #include <chrono>
 #include <cmath>
 #include <cstdio>
@@ -229,27 +231,33 @@ namespace
 		static_assert((factors[std::size(factors) - 1].exp_ - factors[0].exp_) == (GROUP_SIZE * (std::size(factors) - 1))); // The last factor must be GROUP_SIZE * (number of factors - 1) away from the first factor.
 		static_assert(sizeof(factors_t::suffix_)/sizeof(factors_t::suffix_[0]) < suffix_size);
 
-		// Returns the appropriate SI suffix for a given group position.
-		// If the group position does not match a known SI prefix, returns scientific notation (e.g., "e6").
-		std::string get_suffix(int group_pos)
-		{	std::string result(suffix_size, '\0');
-			if (const int idx = (group_pos - factors[0].exp_) / GROUP_SIZE; idx >= 0 && static_cast<std::size_t>(idx) < std::size(factors))
+		// Writes the appropriate SI suffix for a given group position to [first, last).
+		// If the group position does not match a known SI prefix, writes scientific notation (e.g., "e6").
+		// Returns a pointer past the last written character, or nullptr if the buffer is too small.
+		char* put_suffix(char *first, char *last, int group_pos) noexcept
+		{	if (const int idx = (group_pos - factors[0].exp_) / GROUP_SIZE; idx >= 0 && static_cast<std::size_t>(idx) < std::size(factors))
 			{	assert(factors[idx].exp_ == group_pos);
-				result = factors[idx].suffix_;
+				const std::string_view suffix{ factors[idx].suffix_ };
+				if (static_cast<std::size_t>(last - first) < suffix.size())
+				{	return nullptr;
+				}
+				return std::copy(suffix.begin(), suffix.end(), first);
 			}
-			else
-			{	std::snprintf(result.data(), result.size(), "e%d", group_pos);
-				result.shrink_to_fit();
+
+			if (first == last)
+			{	return nullptr;
 			}
-			return result;
+			*first++ = 'e';
+			const auto [ptr, ec] = std::to_chars(first, last, group_pos);
+			return std::errc{} == ec ? ptr : nullptr;
 		}
 
-		// Converts a floating-point value to a tuple containing a rounded value and its SI suffix.
+		// Converts a floating-point value to a tuple containing a rounded value and its SI group position.
 		// - val_org: The original value to convert.
 		// - sig_pos: The position of the most significant digit (zero-based).
 		// - dec: The number of decimal places to display.
-		// Returns: (rounded value, SI suffix or scientific notation).
-		std::tuple<double, std::string> to_string_aux2(double val_org, int sig_pos, unsigned char const dec)
+		// Returns: (rounded value, exponent of the SI suffix or scientific notation).
+		std::tuple<double, int> to_chars_aux2(double val_org, int sig_pos, unsigned char const dec)
 		{	assert(std::abs(val_org) >= DBL_MIN && sig_pos >= dec);
 
 			auto val = std::abs(val_org);
@@ -281,50 +289,125 @@ namespace
 			const auto group_pos = (group_div(fact) - group_div(sig_pos - dec)) * GROUP_SIZE;
 			val *= std::pow(10, rounded_f - group_pos);
 			assert(0 == errno);
-			return { std::copysign(val, val_org), get_suffix(group_pos) };
+			return { std::copysign(val, val_org), group_pos };
 		}
 
-		// Converts a floating-point value to a formatted string with SI suffix or scientific notation.
+		// Converts a floating-point value to text with SI suffix or scientific notation.
+		// - first, last: The output buffer.
 		// - val_org: The original value to convert.
 		// - sig: Number of significant digits to display.
 		// - dec: Number of decimal places to display.
-		// Returns: Formatted string representation of the value.
-		std::string to_string_aux(double val_org, unsigned char sig, unsigned char const dec)
+		// Returns: A pointer past the last written character, or nullptr if the buffer is too small.
+		char* to_chars_aux(char *first, char *last, double val_org, unsigned char sig, unsigned char const dec)
 		{	assert(0 == errno);
 			assert(sig > dec);
-			const auto [val, suffix] = std::isnormal(val_org) ?
-				to_string_aux2(val_org, sig - 1, dec) :
-				std::make_tuple(+0.0, "  ");
-
-			std::string result(sig + (9 + 1), '\0'); // 2.1 -> "-  2.2e-308" -> 9 + 2; 6.2 -> "-  6666.66e-308" -> 9 + 6;
-			const auto len = static_cast<std::size_t>(std::snprintf(result.data(), result.size(), "%.*f%s", dec, val, suffix.data()));
-			if (verify(result.size() > len)) // Error will be converted too long unsigned integer.
-			{	result.resize(len);
-			}
-			else
-			{	result = "ERR";
-			}
-			return result;
+			const auto [val, group_pos] = std::isnormal(val_org) ?
+				to_chars_aux2(val_org, sig - 1, dec) :
+				std::make_tuple(+0.0, 0);
+
+			const auto [ptr, ec] = std::to_chars(first, last, val, std::chars_format::fixed, dec);
+			return std::errc{} == ec ? put_suffix(ptr, last, group_pos) : nullptr;
 		}
 	} // namespace to_str
 } // namespace
 
+// Converts a double value to text with SI prefix or scientific notation, without allocating memory.
+// - first, last: The output buffer; TO_CHARS_SIZE(significant) characters are always enough.
+// - val: The value to convert.
+// - significant: Number of significant digits to display (must be > decimal).
+// - decimal: Number of decimal places to display.
+// Returns: A pointer past the last written character (no null-terminator is written), or 'first' if the buffer is too small.
+char* misc::to_chars(char *first, char *last, double val, unsigned char significant, unsigned char decimal)
+{	std::string_view special;
+	if (!verify(decimal < significant))
+	{	special = "ERR"sv;
+	}
+	else if (std::isnan(val))
+	{	special = "NaN"sv;
+	}
+	else if (std::isinf(val))
+	{	special = std::signbit(val) ? "-INF"sv : "INF"sv;
+	}
+	else if (auto result = to_str::to_chars_aux(first, last, val, significant, decimal); verify(!!result))
+	{	return result;
+	}
+	else
+	{	special = "ERR"sv;
+	}
+
+	if (static_cast<std::size_t>(last - first) < special.size())
+	{	return first;
+	}
+	return std::copy(special.begin(), special.end(), first);
+}
+
+// Rounds a double value exactly as misc::to_chars() does for display, so that values with equal text
+// have equal (bitwise) results and values with different text keep their order. Used as a sort key.
+// - val: The value to round.
+// - significant: Number of significant digits (must be > decimal).
+// - decimal: Number of decimal places.
+// Returns: The rounded value; zero for values that are displayed as zero.
+double misc::quantize(double val, unsigned char significant, unsigned char decimal)
+{	if (!verify(decimal < significant) || !std::isfinite(val))
+	{	return val;
+	}
+	if (!std::isnormal(val))
+	{	return 0.0;
+	}
+
+	const auto [v, group_pos] = to_str::to_chars_aux2(val, significant - 1, decimal);
+	// Integer mantissa of the displayed digits, normalized so that equal texts give equal (mantissa, exponent) pairs.
+	auto mantissa = std::round(std::abs(v) * std::pow(10, decimal));
+	auto exp = group_pos - decimal;
+	while (mantissa >= 10.0 && 0.0 == std::fmod(mantissa, 10.0))
+	{	mantissa /= 10.0;
+		++exp;
+	}
+	if (exp >= 0)
+	{	mantissa *= std::pow(10, exp);
+	}
+	else
+	{	for (; exp < -DBL_MAX_10_EXP; exp += DBL_MAX_10_EXP) // 10^-exp would overflow near DBL_MIN.
+		{	static const auto MAX10 = std::pow(10, DBL_MAX_10_EXP);
+			mantissa /= MAX10;
+		}
+		mantissa /= std::pow(10, -exp);
+	}
+	assert(0 == errno);
+	return std::copysign(mantissa, val);
+}
+
 // Converts a double value to a formatted string with SI prefix or scientific notation.
 // - val: The value to convert.
 // - significant: Number of significant digits to display (must be > decimal).
 // - decimal: Number of decimal places to display.
 // Returns: Formatted string representation, or "ERR" if arguments are invalid.
 std::string misc::to_string(double val, unsigned char significant, unsigned char decimal)
-{	if (!verify(decimal < significant))
-	{	return "ERR";
-	}
-	if (std::isnan(val))
-	{	return "NaN";
-	}
-	if (std::isinf(val))
-	{	return std::signbit(val) ? "-INF" : "INF";
+{	std::string result(TO_CHARS_SIZE(significant), '\0');
+	result.resize(to_chars(result.data(), result.data() + result.size(), val, significant, decimal) - result.data());
+	return result;
+}
+
+// Welch's t-test: t = (mean1 - mean2) / sqrt(se2_1 + se2_2), df by the Welch-Satterthwaite equation.
+// Returns zeros if both standard errors are zero.
+misc::welch_t misc::welch(double mean1, double se2_1, double n1, double mean2, double se2_2, double n2) noexcept
+{	assert(n1 >= 2.0 && n2 >= 2.0);
+	const auto se2 = se2_1 + se2_2;
+	if (se2 <= 0.0)
+	{	return { 0.0, 0.0 };
 	}
-	return to_str::to_string_aux(val, significant, decimal);
+	return { (mean1 - mean2) / std::sqrt(se2), se2 * se2 / (se2_1 * se2_1 / (n1 - 1.0) + se2_2 * se2_2 / (n2 - 1.0)) };
+}
+
+// Two-sided 95% quantile of Student's t-distribution: the Cornish-Fisher expansion around the normal quantile.
+// The error is below 1% for df >= 3.
+double misc::t_quantile_95(double df) noexcept
+{	constexpr auto z = 1.959964;
+	constexpr auto z3 = z * z * z;
+	constexpr auto z5 = z3 * z * z;
+	constexpr auto z7 = z5 * z * z;
+	return z + (z3 + z) / (4.0 * df) + (5.0 * z5 + 16.0 * z3 + 3.0 * z) / (96.0 * df * df) +
+		(3.0 * z7 + 19.0 * z5 + 17.0 * z3 - 15.0 * z) / (384.0 * df * df * df);
 }
 
 // Sets the current thread's CPU affinity to the processor it is currently running on.
@@ -494,6 +577,18 @@ const void* VI_TM_CALL vi_tmStaticInfo(vi_tmInfo_e info)
 #endif
 #if VI_TM_STAT_USE_MINMAX
 				| vi_tmStatUseMinMax
+#endif
+#if VI_TM_STAT_USE_CPUTIME
+				| vi_tmStatUseCpuTime
+#endif
+#if VI_TM_STAT_USE_PERF
+				| vi_tmStatUsePerf
+#endif
+#if VI_TM_STAT_USE_RUSAGE
+				| vi_tmStatUseRusage
+#endif
+#if VI_TM_PROBE_NESTED
+				| vi_tmProbeNested
 #endif
 				;
 			return &flags; // Returns a pointer to the flags that control the library behavior.
@@ -507,15 +602,17 @@ const void* VI_TM_CALL vi_tmStaticInfo(vi_tmInfo_e info)
 } // vi_tmStaticInfo(vi_tmInfo_e info)
 
 VI_TM_SIZE VI_TM_CALL vi_tmF2A(char *buff, VI_TM_SIZE sz, double val, unsigned char sig, unsigned char dec)
-{	auto str = misc::to_string(val, sig, dec);
-	const auto result = str.size() + 1U;
+{	std::array<char, misc::TO_CHARS_SIZE(UCHAR_MAX)> str;
+	auto len = static_cast<std::size_t>(misc::to_chars(str.data(), str.data() + str.size(), val, sig, dec) - str.data());
+	const auto result = len + 1U;
 	
 	if (nullptr != buff && 0U != sz)
 	{	if (result > sz)
-		{	str.resize(sz - 1U); // Resize to fit the buffer, leaving space for null-termination.
+		{	len = sz - 1U; // Truncate to fit the buffer, leaving space for null-termination.
 		}
 
-		std::memcpy(buff, str.data(), str.size() + 1);
+		std::memcpy(buff, str.data(), len);
+		buff[len] = '\0';
 	}
 
 	return result; // Return the size of the string that was copied or the required size if it didn't fit.
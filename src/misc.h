@@ -3,9 +3,10 @@
 #	pragma once
 
 #include <cassert>
+#include <charconv> // For std::to_chars
 #include <chrono>
 #include <cstddef>
-#include <locale> // for std::numpunct
+#include <iterator>
 #include <string_view>
 #include <string>
 #ifdef __cpp_lib_source_location
@@ -18,11 +19,6 @@ struct vi_tmRegistry_t;
 
 namespace misc
 {
-	struct space_out final: std::numpunct<char>
-	{	char do_thousands_sep() const override { return '\''; }  // separate with '
-		std::string do_grouping() const override { return "\3"; } // groups of 3 digit
-	};
-
 	struct properties_t
 	{	std::chrono::duration<double> seconds_per_tick_; // [nanoseconds]
 		double clock_overhead_ticks_; // Duration of one clock call [ticks]
@@ -30,14 +26,78 @@ namespace misc
 		double duration_threadsafe_; // Duration of one measurement with preservation. [ticks]
 		double clock_resolution_ticks_; // [ticks]
 		static const properties_t& props();
+		static bool calibrating() noexcept; // True on the thread that is running the constructor, i.e. within props() being initialized.
 	private:
 		properties_t();
 		static const properties_t self_;
 	};
 
+	// Buffer size sufficient for misc::to_chars() with the given number of significant digits: "-  6666.66e-308" -> sig + 9.
+	constexpr std::size_t TO_CHARS_SIZE(unsigned char significant) noexcept { return significant + 9U; }
+	char* to_chars(char *first, char *last, double d, unsigned char precision, unsigned char dec);
 	[[nodiscard]] std::string to_string(double d, unsigned char precision, unsigned char dec);
+	[[nodiscard]] double quantize(double d, unsigned char precision, unsigned char dec);
 
 	vi_tmRegistry_t* from_handle(vi_tmRegistry_t* handle);
+
+	// Welch's t-test of the difference of two means (mean1 - mean2): the t statistic and the Welch-Satterthwaite degrees of freedom.
+	// se2 - the squared standard errors of the means, n - the sample sizes (at least 2).
+	struct welch_t
+	{	double t_;
+		double df_;
+	};
+	[[nodiscard]] welch_t welch(double mean1, double se2_1, double n1, double mean2, double se2_2, double n2) noexcept;
+	[[nodiscard]] double t_quantile_95(double df) noexcept; // Two-sided 95% quantile of Student's t-distribution.
+
+	// writer_t: Accumulates text in a single reusable buffer and passes it
+	// to the callback in large chunks of complete lines instead of line by line.
+	template<typename F>
+	class writer_t
+	{	static constexpr std::size_t CHUNK_SIZE = 16U * 1024U;
+		const F &fn_;
+		std::string buff_;
+		int result_ = 0;
+	public:
+		explicit writer_t(const F &fn): fn_{ fn } { buff_.reserve(CHUNK_SIZE + 1024U); }
+		writer_t(const writer_t &) = delete;
+		writer_t &operator=(const writer_t &) = delete;
+
+		[[nodiscard]] std::size_t size() const noexcept { return buff_.size(); }
+		void put(std::string_view s) { buff_.append(s); }
+		void put(char c, std::size_t n = 1U) { buff_.append(n, c); }
+		template<typename T>
+		void put_num(T v) // Integers and doubles (shortest round-trip form) via std::to_chars.
+		{	char str[32];
+			const auto [end, ec] = std::to_chars(std::begin(str), std::end(str), v);
+			assert(std::errc{} == ec);
+			buff_.append(str, end);
+		}
+		void left(std::string_view s, std::size_t width, char fill = ' ')
+		{	put(s);
+			if (width > s.size())
+			{	put(fill, width - s.size());
+			}
+		}
+		void right(std::string_view s, std::size_t width)
+		{	if (width > s.size())
+			{	put(' ', width - s.size());
+			}
+			put(s);
+		}
+		void end_line()
+		{	buff_ += '\n';
+			if (buff_.size() >= CHUNK_SIZE)
+			{	flush();
+			}
+		}
+		int flush()
+		{	if (!buff_.empty())
+			{	result_ += fn_(buff_.c_str());
+				buff_.clear();
+			}
+			return result_;
+		}
+	};
 }
 
 #endif // #ifndef VI_TIMING_SOURCE_INTERNAL_H
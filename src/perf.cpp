@@ -0,0 +1,272 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+/*****************************************************************************\
+* This file is part of the vi_timing library.
+*
+* vi_timing - a compact, lightweight C/C++ library for measuring code
+* execution time. It was developed for experimental and educational purposes,
+* so please keep expectations reasonable.
+*
+* Report bugs or suggest improvements to author: <programmer.amateur@proton.me>
+*
+* LICENSE & DISCLAIMER:
+* - No warranties. Use at your own risk.
+* - Licensed under Business Source License 1.1 (BSL-1.1):
+*   - Free for non-commercial use.
+*   - For commercial licensing, contact the author.
+*   - Change Date: 2029-09-01 - after which the library will be licensed
+*     under GNU GPLv3.
+*   - Attribution required: "vi_timing Library (c) A.Prograamar".
+*   - See LICENSE in the project root for full terms.
+\*****************************************************************************/
+
+#include "build_number_generator.h"
+#include "misc.h"
+#include "perf.h"
+#include <vi_timing/vi_timing.h>
+
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__linux__)
+#	include <linux/perf_event.h>
+#	include <sys/mman.h> // For mmap of the counter pages (rdpmc).
+#	include <sys/syscall.h> // For SYS_perf_event_open.
+#	include <unistd.h>
+#	define VI_TM_HAS_PERF 1
+#	if defined(__x86_64__) || defined(__i386__)
+#		define VI_TM_HAS_RDPMC 1
+#	else
+#		define VI_TM_HAS_RDPMC 0
+#	endif
+#else
+#	define VI_TM_HAS_PERF 0
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#	include <sys/resource.h> // For getrusage.
+#endif
+
+namespace
+{
+	constexpr const char *hardware_names[VI_TM_PERF_COUNTERS]{ "instructions", "cycles", "llc-misses", "branch-misses" };
+	constexpr const char *software_names[VI_TM_PERF_COUNTERS]{ "task-clock", "page-faults", "context-switches", "cpu-migrations" };
+
+#if VI_TM_HAS_PERF
+	struct event_t
+	{	std::uint32_t type_;
+		std::uint64_t config_;
+	};
+
+	constexpr event_t hardware_events[VI_TM_PERF_COUNTERS]
+	{	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES }, // Last level cache on most PMUs.
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+	};
+
+	// Fallback for containers and VMs without a virtual PMU.
+	constexpr event_t software_events[VI_TM_PERF_COUNTERS]
+	{	{ PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+		{ PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+		{ PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+		{ PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS },
+	};
+
+	// group_t: The counters of the calling thread, opened as one perf_event group so they are scheduled together.
+	// Hardware counters are read in user space with rdpmc when the kernel allows it, otherwise with one read() of the group.
+	class group_t
+	{	int fd_[VI_TM_PERF_COUNTERS]{ -1, -1, -1, -1 };
+		perf_event_mmap_page *page_[VI_TM_PERF_COUNTERS]{};
+		std::size_t page_size_ = 0U;
+
+		bool read_rdpmc(VI_TM_TDIFF *dst) const noexcept;
+		bool read_group(VI_TM_TDIFF *dst) const noexcept;
+	public:
+		group_t() = default;
+		explicit group_t(perf::mode_t mode) noexcept
+		{	switch (mode)
+			{
+			case perf::mode_t::hardware: open(hardware_events); break;
+			case perf::mode_t::software: open(software_events); break;
+			default: break;
+			}
+		}
+		group_t(const group_t &) = delete;
+		group_t &operator=(const group_t &) = delete;
+		~group_t() { close(); }
+
+		bool open(const event_t (&events)[VI_TM_PERF_COUNTERS]) noexcept;
+		void close() noexcept;
+		bool is_open() const noexcept { return fd_[0] >= 0; }
+		bool read(VI_TM_TDIFF *dst) const noexcept { return read_rdpmc(dst) || read_group(dst); }
+	};
+
+	int open_event(const event_t &e, int group_fd, bool exclude_kernel) noexcept
+	{	perf_event_attr attr{};
+		attr.size = sizeof(attr);
+		attr.type = e.type_;
+		attr.config = e.config_;
+		attr.read_format = PERF_FORMAT_GROUP;
+		attr.exclude_kernel = exclude_kernel ? 1U : 0U;
+		attr.exclude_hv = 1U;
+		// pid == 0, cpu == -1: the calling thread on any CPU.
+		return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC));
+	}
+
+	bool group_t::open(const event_t (&events)[VI_TM_PERF_COUNTERS]) noexcept
+	{	assert(!is_open());
+		// Kernel events (context switches, page faults) are only visible with exclude_kernel == 0,
+		// which perf_event_paranoid >= 2 forbids to unprivileged users: then count user space only.
+		for (const bool exclude_kernel : { false, true })
+		{	for (unsigned n = 0; n < VI_TM_PERF_COUNTERS; ++n)
+			{	fd_[n] = open_event(events[n], n ? fd_[0] : -1, exclude_kernel);
+				if (fd_[n] < 0)
+				{	close();
+					break;
+				}
+			}
+			if (is_open())
+			{	break;
+			}
+		}
+
+#	if VI_TM_HAS_RDPMC
+		if (is_open() && PERF_TYPE_HARDWARE == events[0].type_)
+		{	page_size_ = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+			for (unsigned n = 0; n < VI_TM_PERF_COUNTERS; ++n)
+			{	const auto addr = mmap(nullptr, page_size_, PROT_READ, MAP_SHARED, fd_[n], 0);
+				page_[n] = (MAP_FAILED == addr) ? nullptr : static_cast<perf_event_mmap_page *>(addr);
+			}
+		}
+#	endif
+		errno = 0; // The failures above are handled: the caller falls back to other events or reports the result.
+		return is_open();
+	}
+
+	void group_t::close() noexcept
+	{	for (unsigned n = VI_TM_PERF_COUNTERS; n-- > 0;) // Members first, then the leader.
+		{	if (page_[n])
+			{	verify(0 == munmap(page_[n], page_size_));
+				page_[n] = nullptr;
+			}
+			if (fd_[n] >= 0)
+			{	verify(0 == ::close(fd_[n]));
+				fd_[n] = -1;
+			}
+		}
+	}
+
+	bool group_t::read_rdpmc(VI_TM_TDIFF *dst) const noexcept
+	{
+#	if VI_TM_HAS_RDPMC
+		for (unsigned n = 0; n < VI_TM_PERF_COUNTERS; ++n)
+		{	const volatile auto *pc = page_[n];
+			if (!pc)
+			{	return false;
+			}
+
+			std::uint32_t seq;
+			std::uint64_t value;
+			do // The kernel updates the page under a sequence lock.
+			{	seq = pc->lock;
+				std::atomic_signal_fence(std::memory_order_acquire);
+				const std::uint32_t idx = pc->index;
+				if (!pc->cap_user_rdpmc || 0U == idx)
+				{	return false; // rdpmc is disabled or the counter is not scheduled on the PMU right now.
+				}
+				const auto shift = 64U - pc->pmc_width;
+				const auto raw = static_cast<std::uint64_t>(__builtin_ia32_rdpmc(static_cast<int>(idx - 1U)));
+				value = pc->offset + static_cast<std::uint64_t>(static_cast<std::int64_t>(raw << shift) >> shift);
+				std::atomic_signal_fence(std::memory_order_acquire);
+			} while (pc->lock != seq);
+			dst[n] = value;
+		}
+		return true;
+#	else
+		(void)dst;
+		return false;
+#	endif
+	}
+
+	bool group_t::read_group(VI_TM_TDIFF *dst) const noexcept
+	{	struct
+		{	std::uint64_t nr_;
+			std::uint64_t values_[VI_TM_PERF_COUNTERS];
+		} buff;
+		if (!is_open() || static_cast<ssize_t>(sizeof(buff)) != ::read(fd_[0], &buff, sizeof(buff)) || VI_TM_PERF_COUNTERS != buff.nr_)
+		{	return false;
+		}
+		std::memcpy(dst, buff.values_, sizeof(buff.values_));
+		return true;
+	}
+
+	perf::mode_t detect() noexcept
+	{	group_t probe;
+		if (probe.open(hardware_events))
+		{	return perf::mode_t::hardware;
+		}
+		if (probe.open(software_events))
+		{	return perf::mode_t::software;
+		}
+		return perf::mode_t::none;
+	}
+#endif // #if VI_TM_HAS_PERF
+}
+
+perf::mode_t perf::mode() noexcept
+{
+#if VI_TM_HAS_PERF
+	static const auto result = detect(); // Once per process, so all threads count the same events.
+	return result;
+#else
+	return mode_t::none;
+#endif
+}
+
+VI_TM_RESULT VI_TM_CALL vi_tmPerfRead(VI_TM_TDIFF *dst) noexcept
+{	if (!verify(!!dst))
+	{	return VI_FAILURE;
+	}
+#if VI_TM_HAS_PERF
+	thread_local const group_t group{ perf::mode() }; // Opened once per thread, closed at thread exit.
+	if (group.read(dst))
+	{	return VI_SUCCESS;
+	}
+#endif
+	std::memset(dst, 0, VI_TM_PERF_COUNTERS * sizeof(*dst));
+	return VI_FAILURE;
+}
+
+VI_TM_RESULT VI_TM_CALL vi_tmRusageRead(VI_TM_TDIFF *dst) noexcept
+{	if (!verify(!!dst))
+	{	return VI_FAILURE;
+	}
+#ifdef RUSAGE_THREAD // Linux only: other systems have no per-thread resource usage.
+	if (struct rusage ru; 0 == getrusage(RUSAGE_THREAD, &ru))
+	{	dst[0] = static_cast<VI_TM_TDIFF>(ru.ru_nvcsw);
+		dst[1] = static_cast<VI_TM_TDIFF>(ru.ru_nivcsw);
+		dst[2] = static_cast<VI_TM_TDIFF>(ru.ru_minflt);
+		dst[3] = static_cast<VI_TM_TDIFF>(ru.ru_majflt);
+		return VI_SUCCESS;
+	}
+#endif
+	std::memset(dst, 0, VI_TM_RUSAGE_COUNTERS * sizeof(*dst));
+	return VI_FAILURE;
+}
+
+const char* VI_TM_CALL vi_tmPerfCounterName(unsigned idx) noexcept
+{	if (idx >= VI_TM_PERF_COUNTERS)
+	{	return nullptr;
+	}
+	switch (perf::mode())
+	{
+	case perf::mode_t::hardware: return hardware_names[idx];
+	case perf::mode_t::software: return software_names[idx];
+	default: return nullptr;
+	}
+}
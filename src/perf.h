@@ -0,0 +1,21 @@
+#ifndef VI_TIMING_SOURCE_PERF_H
+#	define VI_TIMING_SOURCE_PERF_H
+#	pragma once
+
+namespace perf
+{
+	// Which events vi_tmPerfRead() counts. Detected once per process.
+	enum class mode_t
+	{	none, // perf_event is unavailable (not Linux, seccomp, perf_event_paranoid == 3).
+		hardware, // instructions, cycles, llc-misses, branch-misses.
+		software, // task-clock, page-faults, context-switches, cpu-migrations.
+	};
+
+	// Indices of the counters in vi_tmStats_t::perf_ for each mode.
+	enum { HW_INSTRUCTIONS, HW_CYCLES, HW_LLC_MISSES, HW_BRANCH_MISSES };
+	enum { SW_TASK_CLOCK, SW_PAGE_FAULTS, SW_CONTEXT_SWITCHES, SW_CPU_MIGRATIONS };
+
+	[[nodiscard]] mode_t mode() noexcept;
+}
+
+#endif // #ifndef VI_TIMING_SOURCE_PERF_H
@@ -30,8 +30,11 @@
 #include <array>
 #include <cassert>
 #include <chrono> // For std::chrono::steady_clock, std::chrono::duration, std::chrono::milliseconds
+#include <cmath> // For std::sqrt
 #include <functional> // For std::invoke_result_t
 #include <iterator>
+#include <limits>
+#include <optional>
 #include <thread> // For std::this_thread::yield()
 #include <utility> // For std::pair, std::index_sequence, std::make_index_sequence, std::forward, std::invoke
 
@@ -50,6 +53,13 @@ namespace
 		"plugh", "xyzzy", "thud", "hoge", "fuga",
 	};
 
+	struct affinity_guard_t // RAII guard to fixate the current thread's affinity.
+	{	affinity_guard_t() { vi_CurrentThreadAffinityFixate(); }
+		~affinity_guard_t() { vi_CurrentThreadAffinityRestore(); }
+		affinity_guard_t(const affinity_guard_t &) = delete;
+		affinity_guard_t &operator=(const affinity_guard_t &) = delete;
+	};
+
 	auto start_tick()
 	{	VI_TM_TICK result;
 		const auto prev = vi_tmGetTicks();
@@ -142,6 +152,23 @@ namespace
 		return (full - base) / static_cast<double>(EXTRA);
 	}
 
+	// The bodies follow scoped_probe_t: with VI_TM_PROBE_NESTED the cost includes the nesting bookkeeping.
+#if VI_TM_PROBE_NESTED
+	void body_duration(VI_TM_HREG registry, const char* name)
+	{	const auto nested = vi_tmNestedProbes();
+		const auto start = vi_tmGetTicks();
+		const auto finish = vi_tmGetTicks();
+		const auto h = vi_tmRegistryGetMeas(registry, name);
+		vi_tmMeasurementAddNested(h, 1000 + finish - start, vi_tmNestedProbes() - nested, nullptr, 1U);
+	};
+
+	void body_measuring_with_caching(VI_TM_HMEAS m)
+	{	const auto nested = vi_tmNestedProbes();
+		const auto start = vi_tmGetTicks();
+		const auto finish = vi_tmGetTicks();
+		vi_tmMeasurementAddNested(m, 1000 + finish - start, vi_tmNestedProbes() - nested, nullptr, 1U);
+	};
+#else
 	void body_duration(VI_TM_HREG registry, const char* name)
 	{	const auto start = vi_tmGetTicks();
 		const auto finish = vi_tmGetTicks();
@@ -154,6 +181,7 @@ namespace
 		const auto finish = vi_tmGetTicks();
 		vi_tmMeasurementAdd(m, 1000 + finish - start, 1U);
 	};
+#endif
 
 	double meas_resolution()
 	{	constexpr auto N = 8U;
@@ -208,6 +236,129 @@ namespace
 	{	auto registry = create_registry();
 		return (verify(!!registry)) ? calc_diff_ticks(body_duration, registry.get(), SERVICE_NAME) : 0.0;
 	}
+
+	void VI_TM_CALL bench_empty(void*) {/**/}
+
+	// Duration of 'n' calls of the function, from the start of a new clock interval.
+	VI_TM_TICK bench_batch(vi_tmBenchFn_t fn, void *ctx, VI_TM_SIZE n)
+	{	const volatile auto f = fn; // Keeps the empty baseline body from being inlined and the loop from being removed.
+		const auto s = start_tick();
+		for (auto i = n; i; --i)
+		{	f(ctx);
+		}
+		return vi_tmGetTicks() - s;
+	}
+
+	// Welford's online mean and variance of the per-iteration durations of the batches.
+	struct welford_t
+	{	VI_TM_SIZE n_ = 0U;
+		double mean_ = 0.0;
+		double m2_ = 0.0;
+		void add(double x) noexcept
+		{	++n_;
+			const auto d = x - mean_;
+			mean_ += d / static_cast<double>(n_);
+			m2_ += d * (x - mean_);
+		}
+		double rse() const noexcept // Relative standard error of the mean.
+		{	if (n_ < 2U || mean_ <= 0.0)
+			{	return HUGE_VAL;
+			}
+			return std::sqrt(m2_ / static_cast<double>(n_ - 1U) / static_cast<double>(n_)) / mean_;
+		}
+	};
+
+	// bench_t: The common part of vi_tmBench and vi_tmBenchAB: options, CPU fixation, calibration of the batch length and the baseline.
+	class bench_t
+	{	vi_tmBenchOptions_t opt_;
+		const misc::properties_t &props_ = misc::properties_t::props(); // Before fixating the affinity: the calibration does it itself.
+		std::optional<affinity_guard_t> affinity_guard_;
+		double deadline_ = 0.0;
+		VI_TM_SIZE n_ = 1U; // Iterations per batch.
+		double base_ = 0.0; // The cost of the loop, of the indirect call and of one clock read [ticks].
+		VI_TM_TICK base_loop_ = 0U; // The same without the clock overhead, which the report subtracts itself [ticks].
+	public:
+		explicit bench_t(const vi_tmBenchOptions_t *opt)
+		:	opt_{ opt ? *opt : vi_tmBenchOptions_t{} }
+		{	const auto or_default = [](auto v, decltype(v) def) { return v > 0 ? v : def; };
+			opt_.target_rse_ = or_default(opt_.target_rse_, 0.01);
+			opt_.max_seconds_ = or_default(opt_.max_seconds_, 1.0);
+			opt_.batch_seconds_ = or_default(opt_.batch_seconds_, 0.001);
+			opt_.max_batches_ = or_default(opt_.max_batches_, VI_TM_SIZE{ 1'000U });
+			opt_.min_batches_ = std::min(or_default(opt_.min_batches_, VI_TM_SIZE{ 10U }), opt_.max_batches_);
+
+			if (0U == (opt_.flags_ & vi_tmBenchNoAffinity))
+			{	affinity_guard_.emplace();
+			}
+			if (0U == (opt_.flags_ & vi_tmBenchNoWarmUp))
+			{	vi_WarmUp(1, 100);
+			}
+			deadline_ = static_cast<double>(vi_tmGetTicks()) + opt_.max_seconds_ / seconds_per_tick();
+		}
+
+		const vi_tmBenchOptions_t &opt() const noexcept { return opt_; }
+		VI_TM_SIZE iterations() const noexcept { return n_; }
+		double seconds_per_tick() const noexcept { return props_.seconds_per_tick_.count(); }
+		double clock_overhead() const noexcept { return props_.clock_overhead_ticks_; }
+		bool expired() const noexcept { return static_cast<double>(vi_tmGetTicks()) >= deadline_; }
+
+		// Doubles the number of iterations until a batch is long enough for the clock resolution and overhead to be negligible.
+		void calibrate(vi_tmBenchFn_t fn, void *ctx)
+		{	const auto min_ticks = std::max(1'000.0 * std::max(props_.clock_resolution_ticks_, props_.clock_overhead_ticks_), opt_.batch_seconds_ / seconds_per_tick());
+			while (static_cast<double>(bench_batch(fn, ctx, n_)) < min_ticks && n_ < (std::numeric_limits<VI_TM_SIZE>::max)() / 2U && !expired())
+			{	n_ *= 2U;
+			}
+		}
+
+		// Runs the CACHE_WARMUP batches that are ignored, then measures the baseline: the median of the empty batches.
+		void warm_up(vi_tmBenchFn_t fn, void *ctx)
+		{	for (auto i = CACHE_WARMUP; i; --i)
+			{	(void)bench_batch(fn, ctx, n_);
+			}
+		}
+		void baseline()
+		{	std::array<VI_TM_TICK, 15U + CACHE_WARMUP> empty;
+			for (auto &e : empty)
+			{	e = bench_batch(bench_empty, nullptr, n_);
+			}
+			base_ = static_cast<double>(median_part(empty, CACHE_WARMUP));
+			base_loop_ = static_cast<VI_TM_TICK>(std::max(0.0, base_ - props_.clock_overhead_ticks_));
+		}
+
+		// Measures one batch and adds it to the measurement and, optionally, to the statistics. Returns the duration of one iteration [ticks].
+		double run(vi_tmBenchFn_t fn, void *ctx, VI_TM_HMEAS meas, vi_tmStats_t *stats = nullptr)
+		{	const auto d = bench_batch(fn, ctx, n_);
+			const auto dur = d > base_loop_ ? d - base_loop_ : 0U;
+			vi_tmMeasurementAdd(meas, dur, n_);
+			if (stats)
+			{	vi_tmStatsAdd(stats, dur, n_);
+			}
+			return (static_cast<double>(d) - base_) / static_cast<double>(n_);
+		}
+
+		bool done(const welford_t &acc) const noexcept
+		{	return acc.n_ >= opt_.max_batches_ || (acc.n_ >= opt_.min_batches_ && acc.rse() <= opt_.target_rse_);
+		}
+
+		void result(const welford_t &acc, vi_tmBenchResult_t *dst) const noexcept
+		{	if (dst)
+			{	dst->batches_ = acc.n_;
+				dst->iterations_ = n_;
+				dst->mean_ = acc.mean_ * seconds_per_tick();
+				dst->rse_ = acc.rse();
+			}
+		}
+	};
+
+#if VI_TM_STAT_USE_RMSE
+	// Mean and squared standard error of the per-iteration duration of the batches. The batches have equal length,
+	// so the event-weighted flt_ss_ is the sum of squared deviations of the batch means multiplied by their length.
+	auto mean_and_se2(const vi_tmStats_t &s, double overhead)
+	{	const auto n = s.flt_cnt_ / static_cast<double>(s.flt_calls_);
+		const auto k = static_cast<double>(s.flt_calls_);
+		return std::pair{ s.flt_avg_ - overhead / n, s.flt_ss_ / n / (k - 1.0) / k };
+	}
+#endif
 } // namespace
 
 const misc::properties_t&
@@ -216,12 +367,20 @@ misc::properties_t::props()
 	return self;
 }
 
+namespace
+{	thread_local bool calibrating = false;
+}
+
+bool misc::properties_t::calibrating() noexcept
+{	return ::calibrating;
+}
+
 misc::properties_t::properties_t()
-{
-	struct affinity_guard_t // RAII guard to fixate the current thread's affinity.
-	{	affinity_guard_t() { vi_CurrentThreadAffinityFixate(); }
-		~affinity_guard_t() { vi_CurrentThreadAffinityRestore(); }
-	} affinity_guard; // Fixate the current thread's affinity to avoid issues with clock resolution measurement.
+{	struct calibrating_t
+	{	calibrating_t() noexcept { ::calibrating = true; }
+		~calibrating_t() { ::calibrating = false; }
+	} const calibrating_guard;
+	const affinity_guard_t affinity_guard; // Fixate the current thread's affinity to avoid issues with clock resolution measurement.
 
 	vi_WarmUp(1, 500);
 
@@ -231,3 +390,109 @@ misc::properties_t::properties_t()
 	duration_threadsafe_ = meas_duration_with_caching(); // The cost of a single measurement with preservation in ticks.
 	duration_ex_threadsafe_ = meas_duration(); // The cost of a single measurement in ticks.
 }
+
+VI_TM_RESULT VI_TM_CALL vi_tmBench(VI_TM_HREG hreg, const char *name, vi_tmBenchFn_t fn, void *ctx, const vi_tmBenchOptions_t *opt, vi_tmBenchResult_t *result)
+{	if (!verify(!!name && !!fn))
+	{	return VI_FAILURE;
+	}
+	const auto meas = vi_tmRegistryGetMeas(hreg, name);
+	if (!meas)
+	{	return VI_FAILURE;
+	}
+
+	bench_t bench{ opt };
+	bench.calibrate(fn, ctx);
+	bench.warm_up(fn, ctx);
+	bench.baseline();
+
+	welford_t acc;
+	do
+	{	acc.add(bench.run(fn, ctx, meas));
+	} while (!bench.done(acc) && !bench.expired());
+
+	bench.result(acc, result);
+	return VI_SUCCESS;
+}
+
+VI_TM_RESULT VI_TM_CALL vi_tmBenchAB(
+	VI_TM_HREG hreg,
+	const char *name_a, vi_tmBenchFn_t fn_a, void *ctx_a,
+	const char *name_b, vi_tmBenchFn_t fn_b, void *ctx_b,
+	const vi_tmBenchOptions_t *opt,
+	vi_tmBenchABResult_t *result
+)
+{
+#if VI_TM_STAT_USE_RMSE
+	if (!verify(!!name_a && !!fn_a && !!name_b && !!fn_b))
+	{	return VI_FAILURE;
+	}
+	const auto meas_a = vi_tmRegistryGetMeas(hreg, name_a);
+	const auto meas_b = vi_tmRegistryGetMeas(hreg, name_b);
+	if (!meas_a || !meas_b || meas_a == meas_b)
+	{	return VI_FAILURE;
+	}
+
+	bench_t bench{ opt };
+	bench.calibrate(fn_a, ctx_a);
+	bench.calibrate(fn_b, ctx_b); // Both variants use the batch length of the slower one.
+	bench.warm_up(fn_a, ctx_a);
+	bench.warm_up(fn_b, ctx_b);
+	bench.baseline();
+
+	// Short batches of the variants alternate in the ABBA order, so a slow drift of the CPU frequency affects both equally.
+	vi_tmStats_t stats_a;
+	vi_tmStats_t stats_b;
+	vi_tmStatsReset(&stats_a);
+	vi_tmStatsReset(&stats_b);
+	welford_t acc_a;
+	welford_t acc_b;
+	do
+	{	if (acc_a.n_ % 2U)
+		{	acc_b.add(bench.run(fn_b, ctx_b, meas_b, &stats_b));
+			acc_a.add(bench.run(fn_a, ctx_a, meas_a, &stats_a));
+		}
+		else
+		{	acc_a.add(bench.run(fn_a, ctx_a, meas_a, &stats_a));
+			acc_b.add(bench.run(fn_b, ctx_b, meas_b, &stats_b));
+		}
+	} while (!(bench.done(acc_a) && bench.done(acc_b)) && !bench.expired());
+
+	if (result)
+	{	bench.result(acc_a, &result->a_);
+		bench.result(acc_b, &result->b_);
+
+		// Welch's t-test on the filtered statistics (outliers are already rejected by vi_tmStatsAdd).
+		result->speedup_ = result->speedup_lo_ = result->speedup_hi_ = 1.0;
+		result->t_ = 0.0;
+		result->df_ = 0.0;
+		result->verdict_ = 0;
+		if (stats_a.flt_calls_ >= 2U && stats_b.flt_calls_ >= 2U)
+		{	const auto [mean_a, se2_a] = mean_and_se2(stats_a, bench.clock_overhead());
+			const auto [mean_b, se2_b] = mean_and_se2(stats_b, bench.clock_overhead());
+			const auto [t, df] = misc::welch
+			(	mean_a, se2_a, static_cast<double>(stats_a.flt_calls_),
+				mean_b, se2_b, static_cast<double>(stats_b.flt_calls_)
+			);
+			if (mean_a > 0.0 && mean_b > 0.0 && df > 0.0)
+			{	result->t_ = t;
+				result->df_ = df;
+				const auto t_crit = misc::t_quantile_95(df);
+
+				// The confidence interval of the ratio of the means by the delta method.
+				const auto speedup = mean_a / mean_b;
+				const auto se_speedup = speedup * std::sqrt(se2_a / (mean_a * mean_a) + se2_b / (mean_b * mean_b));
+				result->speedup_ = speedup;
+				result->speedup_lo_ = speedup - t_crit * se_speedup;
+				result->speedup_hi_ = speedup + t_crit * se_speedup;
+				if (std::abs(result->t_) > t_crit)
+				{	result->verdict_ = result->t_ > 0.0 ? 1 : -1;
+				}
+			}
+		}
+	}
+	return VI_SUCCESS;
+#else
+	(void)hreg; (void)name_a; (void)fn_a; (void)ctx_a; (void)name_b; (void)fn_b; (void)ctx_b; (void)opt; (void)result;
+	return VI_FAILURE;
+#endif
+}
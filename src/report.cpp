@@ -23,16 +23,19 @@
 
 #include "build_number_generator.h"
 #include "misc.h"
+#include "perf.h"
 #include <vi_timing/vi_timing.h>
 
 #include <algorithm>
 #include <cassert>
+#include <charconv> // For std::to_chars
 #include <cmath>
-#include <iomanip>
-#include <numeric>
-#include <sstream>
+#include <cstdint>
+#include <iterator>
 #include <string>
+#include <string_view>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 #ifdef _WIN32
@@ -52,6 +55,18 @@ namespace
 #if VI_TM_STAT_USE_MINMAX
 	constexpr auto TitleMin = "Min."sv;
 	constexpr auto TitleMax = "Max."sv;
+#endif
+#if VI_TM_STAT_USE_CPUTIME
+	constexpr auto TitleCpu = "CPU"sv;
+	constexpr auto TitleOffCpu = "Off-CPU"sv;
+#endif
+#if VI_TM_STAT_USE_PERF
+	constexpr auto TitleIpc = "IPC"sv; // Instructions per cycle (hardware counters).
+	constexpr auto TitleCtxSw = "Ctx.sw"sv; // Context switches per call (software events fallback).
+#endif
+#if VI_TM_STAT_USE_RUSAGE
+	// In the order of vi_tmRusageRead.
+	constexpr std::string_view TitleRusage[VI_TM_RUSAGE_COUNTERS]{ "VCsw"sv, "ICsw"sv, "MinFlt"sv, "MajFlt"sv };
 #endif
 	constexpr auto Ascending = " (^)"sv;
 	constexpr auto Descending = " (v)"sv;
@@ -62,73 +77,207 @@ namespace
 	constexpr unsigned char DURATION_PREC = 2;
 	constexpr unsigned char DURATION_DEC = 1;
 
-	template<unsigned char P, unsigned char D>
-	struct duration_t: std::chrono::duration<double> // A new type is defined to be able to overload the 'operator<'.
-	{
-		template<typename T>
-		constexpr duration_t(T &&v): std::chrono::duration<double>{ std::forward<T>(v) } {}
-		duration_t() = default;
-
-		[[nodiscard]] friend std::string to_string(const duration_t &d) { return misc::to_string(d.count(), P, D) + "s"; }
-		[[nodiscard]] friend bool operator<(const duration_t &l, const duration_t &r)
-			{	return l.count() < r.count() && to_string(l) != to_string(r);
+	constexpr char THOUSANDS_SEP = '\''; // Groups of 3 digits are separated with '.
+	constexpr std::size_t UINT_SEP_SIZE = 27U; // "18'446'744'073'709'551'615" - the longest 64-bit number with separators.
+
+	// Writes 'n' with thousands separators. Returns a pointer past the last written character.
+	char *put_uint_sep(char *dst, std::uint64_t n) noexcept
+	{	char digits[20];
+		const auto [end, ec] = std::to_chars(std::begin(digits), std::end(digits), n);
+		assert(std::errc{} == ec);
+		const auto len = static_cast<std::size_t>(end - digits);
+		for (std::size_t i = 0; i < len; ++i)
+		{	if (0U != i && 0U == (len - i) % 3U)
+			{	*dst++ = THOUSANDS_SEP;
 			}
+			*dst++ = digits[i];
+		}
+		return dst;
+	}
+
+	// Writes 'n' right-aligned in a column of 'width' characters, with thousands separators.
+	template<typename F>
+	void put_right(misc::writer_t<F> &w, std::uint64_t n, std::size_t width)
+	{	char str[UINT_SEP_SIZE];
+		const auto end = put_uint_sep(str, n);
+		w.right(std::string_view{ str, static_cast<std::size_t>(end - str) }, width);
+	}
+
+	std::size_t num_len_with_sep(std::uint64_t n) noexcept
+	{	std::size_t digits = 1;
+		for (; n >= 10U; n /= 10U)
+		{	++digits;
+		}
+		return digits + (digits - 1) / 3;
+	}
+
+	// Fixed-capacity text of a report cell. Keeps metering_t free of heap allocations.
+	class cell_t
+	{	static constexpr std::size_t CAPACITY = 15U;
+		char str_[CAPACITY]{};
+		unsigned char len_ = 0U;
+	public:
+		cell_t() = default;
+		cell_t(std::string_view s) noexcept
+		:	len_{ static_cast<unsigned char>(std::min(s.size(), CAPACITY)) }
+		{	assert(s.size() <= CAPACITY);
+			std::copy_n(s.data(), len_, str_);
+		}
+		cell_t(double val, unsigned char sig, unsigned char dec, char unit) noexcept
+		{	static_assert(misc::TO_CHARS_SIZE(DURATION_PREC) + 1U <= CAPACITY);
+			auto end = misc::to_chars(std::begin(str_), std::end(str_) - 1, val, sig, dec);
+			*end++ = unit;
+			len_ = static_cast<unsigned char>(end - str_);
+		}
+		[[nodiscard]] std::size_t length() const noexcept { return len_; }
+		[[nodiscard]] bool empty() const noexcept { return 0U == len_; }
+		operator std::string_view() const noexcept { return { str_, len_ }; }
+		friend bool operator==(const cell_t &l, const cell_t &r) noexcept { return std::string_view{ l } == std::string_view{ r }; }
+		friend bool operator!=(const cell_t &l, const cell_t &r) noexcept { return !(l == r); }
 	};
 
-	struct metering_t
-	{	std::string name_; // Name of the measured.
-		std::size_t calls_{};
+	// Sort keys of durations are seconds rounded to the displayed precision (see misc::quantize()):
+	// values that look the same in the report compare equal, so the next key of the sort tuple decides.
+	// They are computed once per entry, so sorting never formats or re-derives anything.
+	[[nodiscard, maybe_unused]] double to_key(double seconds) { return misc::quantize(seconds, DURATION_PREC, DURATION_DEC); }
+	[[nodiscard]] cell_t to_cell(double seconds) noexcept { return { seconds, DURATION_PREC, DURATION_DEC, 's' }; }
+	// Formats a dimensionless ratio with two decimals: "1.23". Negative values are shown as zero.
+	[[nodiscard]] cell_t to_ratio(double v) noexcept
+	{	const auto centi = static_cast<std::uint64_t>(std::llround(std::max(0.0, v) * 100.0));
+		char str[16];
+		auto end = std::to_chars(std::begin(str), std::end(str) - 3, centi / 100U).ptr;
+		*end++ = '.';
+		*end++ = static_cast<char>('0' + centi / 10U % 10U);
+		*end++ = static_cast<char>('0' + centi % 10U);
+		return std::string_view{ str, static_cast<std::size_t>(end - str) };
+	}
+
+	// The sort keys of a measurement. They are computed for every entry of the report, the texts only for the printed ones.
+	struct keys_t
+	{	std::string name_; // Name of the measured. A copy: the registry entry may be removed once the enumeration ends.
+		std::size_t calls_{}; // Zero - the measurement is invalid or has no calls: nothing is available.
 		std::size_t cnt_{}; // Number of measured units
-		std::string cnt_txt_{ "0" };
-		duration_t<DURATION_PREC, DURATION_DEC> sum_{}; // seconds
-		std::string sum_txt_{ NotAvailable };
-		duration_t<DURATION_PREC, DURATION_DEC> average_{}; // seconds
-		std::string average_txt_{ NotAvailable };
+		double sum_{}; // Sort key: seconds; zero - insignificant.
+		double average_{}; // Sort key: seconds; zero - insignificant.
 #if VI_TM_STAT_USE_RMSE
-		VI_TM_FP cv_{}; // Coefficient of Variation.
-		std::string cv_txt_{ NotAvailable }; // Coefficient of Variation (CV) in percent
+		VI_TM_FP cv_{ -1 }; // Sort key: Coefficient of Variation in whole percent (0 - "<1%", 100 - excessive, -1 - not available).
 #endif
 #if VI_TM_STAT_USE_MINMAX
-		duration_t<DURATION_PREC, DURATION_DEC> min_{}; // Minimum time in seconds
-		std::string min_txt_{ NotAvailable };
-		duration_t<DURATION_PREC, DURATION_DEC> max_{}; // Maximum time in seconds
-		std::string max_txt_{ NotAvailable };
+		double min_{}; // Sort key: minimum time in seconds; zero - insignificant.
+		double max_{}; // Sort key: maximum time in seconds; zero - insignificant.
 #endif
 
-		metering_t(const char *name, const vi_tmStats_t &meas, unsigned flags) noexcept;
+		keys_t(const char *name, const vi_tmStats_t &meas, unsigned flags) noexcept;
 	};
 
-	template<vi_tmReportFlags_e E> auto make_tuple(const metering_t &v);
+	// A row of the report: the keys and their texts.
+	struct metering_t: keys_t
+	{	cell_t sum_txt_{ NotAvailable };
+		cell_t average_txt_{ NotAvailable };
+#if VI_TM_STAT_USE_RMSE
+		cell_t cv_txt_{ NotAvailable }; // Coefficient of Variation (CV) in percent
+#endif
+#if VI_TM_STAT_USE_MINMAX
+		cell_t min_txt_{ NotAvailable };
+		cell_t max_txt_{ NotAvailable };
+#endif
+#if VI_TM_STAT_USE_CPUTIME
+		cell_t cpu_txt_{ NotAvailable }; // Thread CPU time of the measured intervals.
+		cell_t off_cpu_txt_{ NotAvailable }; // Total wall time minus CPU time: blocked, waiting or preempted.
+#endif
+#if VI_TM_STAT_USE_PERF
+		cell_t perf_txt_{ NotAvailable }; // IPC, or context switches per call with the software events fallback.
+#endif
+#if VI_TM_STAT_USE_RUSAGE
+		std::uint64_t rusage_[VI_TM_RUSAGE_COUNTERS]{}; // Voluntary and involuntary context switches, minor and major faults.
+#endif
+
+		metering_t(keys_t &&keys, const vi_tmStats_t &meas) noexcept;
+	};
+
+	// An entry of the registry selected for the report: the statistics are kept to format the row if it is printed.
+	struct entry_t
+	{	keys_t keys_;
+		vi_tmStats_t stats_;
+	};
+
+	vi_tmReportFlags_e to_sort_flag(unsigned flags_)
+	{ // Convert flags_ to vi_tmReportFlags_e type, ensuring it is one of the sorting types available in this build.
+		switch (auto s = flags_ & vi_tmSortMask)
+		{
+		case vi_tmSortByTime:
+		case vi_tmSortByName:
+		case vi_tmSortBySpeed:
+		case vi_tmSortByAmount:
+#if VI_TM_STAT_USE_RMSE
+		case vi_tmSortByCV:
+#endif
+#if VI_TM_STAT_USE_MINMAX
+		case vi_tmSortByMin:
+		case vi_tmSortByMax:
+#endif
+			return static_cast<vi_tmReportFlags_e>(s);
+
+		default:
+			return vi_tmSortByName; // The column is not collected in this build.
+		}
+	}
 
-	template<> auto make_tuple<vi_tmSortByName>(const metering_t &v)
+	template<vi_tmReportFlags_e E> auto make_tuple(const keys_t &v);
+
+	template<> auto make_tuple<vi_tmSortByName>(const keys_t &v)
 	{	return std::tie( v.name_, v.average_, v.sum_, v.cnt_ );
 	}
-	template<> auto make_tuple<vi_tmSortBySpeed>(const metering_t &v)
+	template<> auto make_tuple<vi_tmSortBySpeed>(const keys_t &v)
 	{	return std::tie( v.average_, v.sum_, v.cnt_, v.name_ );
 	}
-	template<> auto make_tuple<vi_tmSortByTime>(const metering_t &v)
+	template<> auto make_tuple<vi_tmSortByTime>(const keys_t &v)
 	{	return std::tie( v.sum_, v.average_, v.cnt_, v.name_ );
 	}
-	template<> auto make_tuple<vi_tmSortByAmount>(const metering_t &v)
+	template<> auto make_tuple<vi_tmSortByAmount>(const keys_t &v)
 	{	return std::tie( v.cnt_, v.average_, v.sum_, v.name_ );
 	}
 
-	template<vi_tmReportFlags_e E> bool less(const metering_t &l, const metering_t &r)
+#if VI_TM_STAT_USE_RMSE
+	template<> auto make_tuple<vi_tmSortByCV>(const keys_t &v)
+	{	return std::tie( v.cv_, v.average_, v.sum_, v.name_ );
+	}
+#endif
+#if VI_TM_STAT_USE_MINMAX
+	template<> auto make_tuple<vi_tmSortByMin>(const keys_t &v)
+	{	return std::tie( v.min_, v.average_, v.sum_, v.name_ );
+	}
+	template<> auto make_tuple<vi_tmSortByMax>(const keys_t &v)
+	{	return std::tie( v.max_, v.average_, v.sum_, v.name_ );
+	}
+#endif
+
+	template<vi_tmReportFlags_e E> bool less(const keys_t &l, const keys_t &r)
 	{	return make_tuple<E>(l) < make_tuple<E>(r);
 	}
 
 	class comparator_t
-	{	bool (*pr_)(const metering_t &, const metering_t &);
+	{	bool (*pr_)(const keys_t &, const keys_t &);
 		const bool ascending_;
 	public:
 		explicit comparator_t(unsigned flags) noexcept
 			: ascending_{ 0 != (flags & vi_tmSortAscending) }
 		{
-			switch (flags & vi_tmSortMask)
+			switch (to_sort_flag(flags))
 			{
+#if VI_TM_STAT_USE_RMSE
+			case vi_tmSortByCV:
+				pr_ = less<vi_tmSortByCV>;
+				break;
+#endif
+#if VI_TM_STAT_USE_MINMAX
 			case vi_tmSortByMin:
+				pr_ = less<vi_tmSortByMin>;
+				break;
 			case vi_tmSortByMax:
-			case vi_tmSortByCV:
+				pr_ = less<vi_tmSortByMax>;
+				break;
+#endif
 			default:
 				assert(false);
 				[[fallthrough]];
@@ -146,9 +295,12 @@ namespace
 				break;
 			}
 		}
-		bool operator ()(const metering_t &l, const metering_t &r) const
+		bool operator ()(const keys_t &l, const keys_t &r) const
 		{	return ascending_ ? pr_(l, r): pr_(r, l);
 		}
+		bool operator ()(const entry_t &l, const entry_t &r) const
+		{	return (*this)(l.keys_, r.keys_);
+		}
 	};
 
 	struct formatter_t
@@ -166,53 +318,80 @@ namespace
 #if VI_TM_STAT_USE_MINMAX
 		std::size_t max_len_min_{TitleMin.length()};
 		std::size_t max_len_max_{TitleMax.length()};
+#endif
+#if VI_TM_STAT_USE_CPUTIME
+		std::size_t max_len_cpu_{TitleCpu.length()};
+		std::size_t max_len_off_cpu_{TitleOffCpu.length()};
+#endif
+#if VI_TM_STAT_USE_PERF
+		const std::string_view title_perf_{ perf::mode_t::software == perf::mode() ? TitleCtxSw : TitleIpc };
+		std::size_t max_len_perf_{title_perf_.length()};
+#endif
+#if VI_TM_STAT_USE_RUSAGE
+		std::size_t max_len_rusage_[VI_TM_RUSAGE_COUNTERS]{};
 #endif
 		std::size_t max_len_total_{TitleTotal.length()};
 		std::size_t max_len_amount_{TitleAmount.length()};
 		mutable std::size_t n_{ 0 };
 
-		struct width_t
-		{	const formatter_t &fmt_;
-			vi_tmReportFlags_e clmn_;
-			friend std::ostream &operator <<(std::ostream &os, const width_t &self)
-			{	return os << std::setw(self.fmt_.width_column(self.clmn_));
-			}
-		};
-		width_t setw(vi_tmReportFlags_e clmn) const noexcept { return { *this, clmn }; }
-
-		struct title_t
-		{	const formatter_t &fmt_;
-			vi_tmReportFlags_e clmn_;
-			friend std::ostream &operator <<(std::ostream &os, const title_t &self)
-			{	return os << self.fmt_.setw(self.clmn_) << self.fmt_.item_column(self.clmn_);
-			}
-		};
-		title_t title(vi_tmReportFlags_e clmn) const noexcept { return { *this, clmn }; }
-
 		formatter_t(const std::vector<metering_t> &itms, unsigned flags);
 		template<typename F>
-		int print_header( const F &fn) const;
+		void print_header(misc::writer_t<F> &w) const;
 		template<typename F>
-		int print_footer( const F &fn) const;
+		void print_footer(misc::writer_t<F> &w) const;
 		template<typename F>
-		int print_metering(const metering_t &i, const F &fn) const;
+		void print_metering(const metering_t &i, misc::writer_t<F> &w) const;
+		template<typename F>
+		void print_title(vi_tmReportFlags_e clmn, misc::writer_t<F> &w, bool left = false) const;
 
 		std::size_t width_column(vi_tmReportFlags_e clmn) const;
-		std::string item_column(vi_tmReportFlags_e clmn) const;
 	};
 
-	std::vector<metering_t> get_meterings(VI_TM_HREG registry_handle, unsigned flags)
-	{	std::vector<metering_t> result;
-		auto data = std::tie(result, flags);
+	// Matches 'name' against a glob 'pattern': '*' matches any sequence, '?' matches any single character.
+	bool glob_match(std::string_view pattern, std::string_view name) noexcept
+	{	constexpr auto npos = std::string_view::npos;
+		std::size_t p = 0U;
+		std::size_t n = 0U;
+		std::size_t star = npos; // Position of the last '*' in the pattern.
+		std::size_t mark = 0U; // Position in the name matched by that '*'.
+		while (n < name.size())
+		{	if (p < pattern.size() && '*' == pattern[p])
+			{	star = p++;
+				mark = n;
+			}
+			else if (p < pattern.size() && ('?' == pattern[p] || pattern[p] == name[n]))
+			{	++p;
+				++n;
+			}
+			else if (npos != star)
+			{	p = star + 1U; // Backtrack: let the last '*' absorb one more character.
+				n = ++mark;
+			}
+			else
+			{	return false;
+			}
+		}
+		while (p < pattern.size() && '*' == pattern[p])
+		{	++p;
+		}
+		return p == pattern.size();
+	}
+
+	std::vector<entry_t> get_entries(VI_TM_HREG registry_handle, unsigned flags, std::string_view filter)
+	{	std::vector<entry_t> result;
+		auto data = std::tie(result, flags, filter);
 		using data_t = decltype(data);
 		vi_tmRegistryEnumerateMeas
 		(	registry_handle,
 			[](VI_TM_HMEAS h, void *callback_data)
-			{	const char *name;
-				vi_tmStats_t meas;
-				vi_tmMeasurementGet(h, &name, &meas);
-				auto& [v, f] = *static_cast<data_t*>(callback_data); // The pointer to void is necessary for C compatibility.
-				v.emplace_back(name, std::move(meas), f);
+			{	auto& [v, f, flt] = *static_cast<data_t*>(callback_data); // The pointer to void is necessary for C compatibility.
+				const char *name;
+				vi_tmMeasurementGet(h, &name, nullptr);
+				if (flt.empty() || glob_match(flt, name)) // The filter is applied before the name and the statistics are copied and converted.
+				{	vi_tmStats_t meas;
+					vi_tmMeasurementGet(h, nullptr, &meas);
+					v.push_back({ keys_t{ name, meas, f }, meas });
+				}
 				return 0; // Ok, continue enumerate.
 			},
 			&data
@@ -221,79 +400,52 @@ namespace
 	}
 
 	template<typename F>
-	int print_props(const F &fn, unsigned flags)
-	{	int result = 0;
-		if (flags & vi_tmShowMask)
-		{	std::ostringstream str;
-			auto &props = misc::properties_t::props();
-
-			auto to_string = [](auto d) { return misc::to_string(d, DURATION_PREC, DURATION_DEC) + "s. "; };
+	void print_props(misc::writer_t<F> &w, unsigned flags)
+	{	if (flags & vi_tmShowMask)
+		{	auto &props = misc::properties_t::props();
+
+			auto put = [&w](std::string_view title, double d)
+				{	w.put(title);
+					w.put(to_cell(d));
+					w.put(". "sv);
+				};
 			if (flags & vi_tmShowAux)
 			{
 #if VI_TM_THREADSAFE
-				str << (flags & vi_tmDoNotSubtractOverhead? "": "Corrected; Thread-safe. ");
+				w.put(flags & vi_tmDoNotSubtractOverhead? ""sv: "Corrected; Thread-safe. "sv);
 #else
-				str << (flags & vi_tmDoNotSubtractOverhead? "": "Corrected. ");
+				w.put(flags & vi_tmDoNotSubtractOverhead? ""sv: "Corrected. "sv);
 #endif
 			}
 
 			const auto tick = props.seconds_per_tick_.count();
 			if (flags & vi_tmShowResolution)
-			{	str << "Resolution: " << to_string(tick * props.clock_resolution_ticks_);
+			{	put("Resolution: "sv, tick * props.clock_resolution_ticks_);
 			}
 			if (flags & vi_tmShowDuration)
-			{	str << "Duration: " << to_string(tick * props.duration_threadsafe_);
+			{	put("Duration: "sv, tick * props.duration_threadsafe_);
 			}
 			if (flags & vi_tmShowDurationEx)
-			{	str << "Duration ex: " << to_string(tick * props.duration_ex_threadsafe_);
+			{	put("Duration ex: "sv, tick * props.duration_ex_threadsafe_);
 			}
 			if (flags & vi_tmShowUnit)
-			{	str << "One tick: " << to_string(tick);
+			{	put("One tick: "sv, tick);
 			}
 			if (flags & vi_tmShowOverhead)
-			{	str << "Overhead: " << to_string(tick * props.clock_overhead_ticks_);
+			{	put("Overhead: "sv, tick * props.clock_overhead_ticks_);
 			}
 
-			str << '\n';
-			result += fn(str.str().c_str());
-		}
-
-		return result;
-	}
-
-	vi_tmReportFlags_e to_sort_flag(unsigned flags_)
-	{ // Convert flags_ to vi_tmReportFlags_e type, ensuring it is one of the defined sorting types.
-		switch (auto s = flags_ & vi_tmSortMask)
-		{
-		case vi_tmSortByTime:
-		case vi_tmSortByName:
-		case vi_tmSortBySpeed:
-		case vi_tmSortByAmount:
-			return static_cast<vi_tmReportFlags_e>(s);
-
-		case vi_tmSortByMin:
-		case vi_tmSortByMax:
-		case vi_tmSortByCV:
-		default:
-			assert(false);
-			return vi_tmSortByName;
+			w.end_line();
 		}
 	}
 
-	std::size_t num_len_with_sep(std::size_t n)
-	{	if (n < 10)
-		{	return 1;
-		}
-		std::size_t digits = static_cast<std::size_t>(std::log10(n)) + 1;
-		return digits + (digits - 1) / 3;
-	}
 } // namespace
 
-metering_t::metering_t(const char *name, const vi_tmStats_t &meas, unsigned flags) noexcept
+keys_t::keys_t(const char *name, const vi_tmStats_t &meas, unsigned flags) noexcept
 :	name_{ name }
 {	
 	if (!verify(VI_SUCCEEDED(vi_tmStatsIsValid(&meas))) || 0 == meas.calls_)
-	{	return; // If the measurement is invalid or has no calls, we do not create a metering_t.
+	{	return; // If the measurement is invalid or has no calls, nothing is available.
 	}
 
 // calls_
@@ -303,49 +455,32 @@ metering_t::metering_t(const char *name, const vi_tmStats_t &meas, unsigned flag
 	const auto &props = misc::properties_t::props();
 	const auto correction_ticks = (0U == (flags & vi_tmDoNotSubtractOverhead)) ? props.clock_overhead_ticks_ : 0.0;
 
-// cnt_, sum_, cnt_txt_ and sum_txt_
+// cnt_ and sum_
 #	if VI_TM_STAT_USE_RAW
 	cnt_ = meas.cnt_;
-	try
-	{	std::ostringstream str_stream;
-		str_stream.imbue(std::locale(str_stream.getloc(), new misc::space_out));
-		str_stream << cnt_;
-		cnt_txt_ = str_stream.str();
-	}
-	catch (const std::exception &)
-	{	assert(false);
-	}
 
 	const auto total_ticks = static_cast<double>(meas.sum_) - correction_ticks * static_cast<double>(meas.calls_); // Total time in ticks, corrected for overhead if necessary.
-	if (total_ticks <= props.clock_resolution_ticks_ * std::sqrt(meas.calls_))
-	{	sum_txt_ = Insignificant;
-	}
-	else
-	{	sum_ = props.seconds_per_tick_ * total_ticks;
-		sum_txt_ = to_string(sum_);
+	if (total_ticks > props.clock_resolution_ticks_ * std::sqrt(meas.calls_))
+	{	sum_ = to_key(props.seconds_per_tick_.count() * total_ticks);
 	}
 #	endif
 
-// average, limit, cv_ and cv_txt_
+// average, limit and cv_
 #	if VI_TM_STAT_USE_RMSE
 	const auto limit_ticks = props.clock_resolution_ticks_ / std::sqrt(meas.flt_cnt_);
 	const auto avg_ticks = meas.flt_avg_ - correction_ticks;
 
 	if (meas.flt_calls_ >= 2) // To calculate the measurement spread, at least two measurements must be taken.
 	{	assert(meas.flt_cnt_ >= static_cast<VI_TM_FP>(2)); // The first two measurements cannot be filtered out.
-		cv_ = std::sqrt(meas.flt_ss_ / (meas.flt_cnt_ - static_cast<VI_TM_FP>(1))) / avg_ticks;
-		if (const auto cv_pct = std::round(cv_ * static_cast<VI_TM_FP>(100)); cv_pct < static_cast<VI_TM_FP>(1))
-		{	cv_txt_ = "<1%"; // Coefficient of Variation (CV) is too low.
+		const auto cv = std::sqrt(meas.flt_ss_ / (meas.flt_cnt_ - static_cast<VI_TM_FP>(1))) / avg_ticks;
+		if (const auto cv_pct = std::round(cv * static_cast<VI_TM_FP>(100)); cv_pct < static_cast<VI_TM_FP>(1))
+		{	cv_ = 0; // Coefficient of Variation (CV) is too low.
 		}
 		else if (cv_pct >= 100.0)
-		{	cv_txt_ = Excessive; // Coefficient of Variation (CV) is too high.
+		{	cv_ = 100; // Coefficient of Variation (CV) is too high.
 		}
 		else
-		{	cv_txt_ = misc::to_string(cv_pct, 2, 0);
-			assert(cv_txt_.back() == ' '); // In these conditions, the last character is always a space.
-			assert(cv_txt_[cv_txt_.size() - 2] == ' ');
-			cv_txt_.resize(cv_txt_.size() - 2);
-			cv_txt_ += '%';
+		{	cv_ = cv_pct;
 		}
 	}
 #	elif VI_TM_STAT_USE_RAW
@@ -353,35 +488,22 @@ metering_t::metering_t(const char *name, const vi_tmStats_t &meas, unsigned flag
 	const auto avg_ticks = total_ticks / static_cast<double>(meas.cnt_);
 #	endif
 
-// average_, average_txt_
+// average_
 #	if VI_TM_STAT_USE_RAW || VI_TM_STAT_USE_RMSE
-	if (avg_ticks <= std::max(limit_ticks, props.clock_resolution_ticks_ * 1e-2))
-	{	average_txt_ = Insignificant;
-	}
-	else
-	{	average_ = props.seconds_per_tick_ * avg_ticks;
-		average_txt_ = to_string(average_);
+	if (avg_ticks > std::max(limit_ticks, props.clock_resolution_ticks_ * 1e-2))
+	{	average_ = to_key(props.seconds_per_tick_.count() * avg_ticks);
 	}
 #	endif
 
-// min_, max_, min_txt_ and max_txt_
+// min_ and max_
 #	if VI_TM_STAT_USE_MINMAX
 	if (meas.calls_ > 1U)
 	{	// If there is more than one measurement, the minimum and maximum values are meaningful.
-		if (const auto ticks = meas.min_ - correction_ticks; ticks <= props.clock_resolution_ticks_)
-		{	min_txt_ = Insignificant;
+		if (const auto ticks = meas.min_ - correction_ticks; ticks > props.clock_resolution_ticks_)
+		{	min_ = to_key(props.seconds_per_tick_.count() * ticks);
 		}
-		else
-		{	min_ = props.seconds_per_tick_ * ticks;
-			min_txt_ = to_string(min_);
-		}
-
-		if (const auto ticks = meas.max_ - correction_ticks; ticks <= props.clock_resolution_ticks_)
-		{	max_txt_ = Insignificant;
-		}
-		else
-		{	max_ = props.seconds_per_tick_ * ticks;
-			max_txt_ = to_string(max_);
+		if (const auto ticks = meas.max_ - correction_ticks; ticks > props.clock_resolution_ticks_)
+		{	max_ = to_key(props.seconds_per_tick_.count() * ticks);
 		}
 	}
 #	endif
@@ -391,11 +513,96 @@ metering_t::metering_t(const char *name, const vi_tmStats_t &meas, unsigned flag
 #endif // #if VI_TM_STAT_USE_RAW || VI_TM_STAT_USE_RMSE || VI_TM_STAT_USE_MINMAX
 }
 
+metering_t::metering_t(keys_t &&keys, [[maybe_unused]] const vi_tmStats_t &meas) noexcept
+:	keys_t{ std::move(keys) }
+{	if (0U == calls_)
+	{	return; // If the measurement is invalid or has no calls, nothing is available.
+	}
+	// A key of zero is a value below the resolution.
+	[[maybe_unused]] const auto duration_cell = [](double key) { return key > 0.0 ? to_cell(key) : cell_t{ Insignificant }; };
+
+// sum_txt_ and average_txt_
+#if VI_TM_STAT_USE_RAW
+	sum_txt_ = duration_cell(sum_);
+#endif
+#if VI_TM_STAT_USE_RAW || VI_TM_STAT_USE_RMSE
+	average_txt_ = duration_cell(average_);
+#endif
+
+// cv_txt_
+#if VI_TM_STAT_USE_RMSE
+	if (cv_ < 0)
+	{	// Not available: fewer than two measurements.
+	}
+	else if (0 == cv_)
+	{	cv_txt_ = "<1%"sv; // Coefficient of Variation (CV) is too low.
+	}
+	else if (cv_ >= 100)
+	{	cv_txt_ = Excessive; // Coefficient of Variation (CV) is too high.
+	}
+	else
+	{	char str[4];
+		auto end = std::to_chars(std::begin(str), std::end(str) - 1, static_cast<unsigned>(cv_)).ptr;
+		*end++ = '%';
+		cv_txt_ = std::string_view{ str, static_cast<std::size_t>(end - str) };
+	}
+#endif
+
+// min_txt_ and max_txt_
+#if VI_TM_STAT_USE_MINMAX
+	if (calls_ > 1U)
+	{	min_txt_ = duration_cell(min_);
+		max_txt_ = duration_cell(max_);
+	}
+#endif
+
+// cpu_txt_ and off_cpu_txt_
+#if VI_TM_STAT_USE_CPUTIME
+	if (0U != meas.cpu_) // Zero if the measurement was collected without CPU time (spans, vi_tmMeasurementAdd).
+	{	const auto cpu = static_cast<double>(meas.cpu_) * 1e-9;
+		cpu_txt_ = to_cell(to_key(cpu));
+#	if VI_TM_STAT_USE_RAW
+		if (sum_ > 0.0)
+		{	off_cpu_txt_ = to_cell(to_key(std::max(0.0, sum_ - cpu))); // The clocks differ in resolution, so CPU time may slightly exceed wall time.
+		}
+#	endif
+	}
+#endif
+
+// perf_txt_
+#if VI_TM_STAT_USE_PERF
+	switch (perf::mode())
+	{
+	case perf::mode_t::hardware:
+		if (0U != meas.perf_[perf::HW_CYCLES]) // Zero if the measurement was collected without perf counters.
+		{	perf_txt_ = to_ratio(static_cast<double>(meas.perf_[perf::HW_INSTRUCTIONS]) / static_cast<double>(meas.perf_[perf::HW_CYCLES]));
+		}
+		break;
+	case perf::mode_t::software:
+		if (0U != meas.perf_[perf::SW_TASK_CLOCK])
+		{	perf_txt_ = to_ratio(static_cast<double>(meas.perf_[perf::SW_CONTEXT_SWITCHES]) / static_cast<double>(meas.calls_));
+		}
+		break;
+	default:
+		break;
+	}
+#endif
+
+// rusage_
+#if VI_TM_STAT_USE_RUSAGE
+	std::copy(std::begin(meas.rusage_), std::end(meas.rusage_), std::begin(rusage_));
+#endif
+}
+
 formatter_t::formatter_t(const std::vector<metering_t> &itms, unsigned flags)
 :	max_len_number_{ std::max(std::size(TitleNumber) - 1U, itms.empty() ? 1U : num_len_with_sep(itms.size())) },
 	flags_{ flags },
 	guideline_interval_{ itms.size() >= 2 * INTERVAL ? INTERVAL : 0U }
 {	
+#if VI_TM_STAT_USE_RUSAGE
+	std::uint64_t max_rusage[VI_TM_RUSAGE_COUNTERS]{};
+#endif
+	std::size_t max_cnt = 0U;
 	for (auto &itm : itms)
 	{	max_len_name_ = std::max(max_len_name_, itm.name_.length());
 #if VI_TM_STAT_USE_RAW
@@ -408,11 +615,25 @@ formatter_t::formatter_t(const std::vector<metering_t> &itms, unsigned flags)
 		max_len_min_ = std::max(max_len_min_, itm.min_txt_.length());
 		max_len_max_ = std::max(max_len_max_, itm.max_txt_.length());
 #endif
+#if VI_TM_STAT_USE_CPUTIME
+		max_len_cpu_ = std::max(max_len_cpu_, itm.cpu_txt_.length());
+		max_len_off_cpu_ = std::max(max_len_off_cpu_, itm.off_cpu_txt_.length());
+#endif
+#if VI_TM_STAT_USE_PERF
+		max_len_perf_ = std::max(max_len_perf_, itm.perf_txt_.length());
+#endif
+#if VI_TM_STAT_USE_RUSAGE
+		for (unsigned n = 0; n < VI_TM_RUSAGE_COUNTERS; ++n) { max_rusage[n] = std::max(max_rusage[n], itm.rusage_[n]); }
+#endif
 #if VI_TM_STAT_USE_RAW || VI_TM_STAT_USE_RMSE
 		max_len_average_ = std::max(max_len_average_, itm.average_txt_.length());
-		max_len_amount_ = std::max(max_len_amount_, itm.cnt_txt_.length());
+		max_cnt = std::max(max_cnt, itm.cnt_);
 #endif
 	}
+	max_len_amount_ = std::max(max_len_amount_, num_len_with_sep(max_cnt)); // The widest count is the largest one.
+#if VI_TM_STAT_USE_RUSAGE
+	for (unsigned n = 0; n < VI_TM_RUSAGE_COUNTERS; ++n) { max_len_rusage_[n] = std::max(TitleRusage[n].length(), num_len_with_sep(max_rusage[n])); }
+#endif
 }
 
 std::size_t formatter_t::width_column(vi_tmReportFlags_e clmn) const
@@ -464,33 +685,34 @@ std::size_t formatter_t::width_column(vi_tmReportFlags_e clmn) const
 	return result;
 }
 
-std::string formatter_t::item_column(vi_tmReportFlags_e clmn) const
-{	std::string result;
+template<typename F>
+void formatter_t::print_title(vi_tmReportFlags_e clmn, misc::writer_t<F> &w, bool left) const
+{	std::string_view title;
 	switch (clmn)
 	{
 	case vi_tmSortByName:
-		result += TitleName;
+		title = TitleName;
 		break;
 	case vi_tmSortBySpeed:
-		result += TitleAverage;
+		title = TitleAverage;
 		break;
 	case vi_tmSortByTime:
-		result += TitleTotal;
+		title = TitleTotal;
 		break;
 	case vi_tmSortByAmount:
-		result += TitleAmount;
+		title = TitleAmount;
 		break;
 #if VI_TM_STAT_USE_RMSE
 	case vi_tmSortByCV:
-		result += TitleCV;
+		title = TitleCV;
 		break;
 #endif
 #if VI_TM_STAT_USE_MINMAX
 	case vi_tmSortByMin:
-		result += TitleMin;
+		title = TitleMin;
 		break;
 	case vi_tmSortByMax:
-		result += TitleMax;
+		title = TitleMax;
 		break;
 #endif
 	default:
@@ -498,50 +720,90 @@ std::string formatter_t::item_column(vi_tmReportFlags_e clmn) const
 		break;
 	}
 
+	std::string_view order;
 	if (to_sort_flag(flags_) == clmn)
-	{	result += (flags_ & vi_tmSortAscending ? Ascending : Descending);
+	{	order = (flags_ & vi_tmSortAscending ? Ascending : Descending);
 	}
 
-	return result;
+	const auto width = width_column(clmn);
+	const auto len = title.length() + order.length();
+	if (!left && width > len)
+	{	w.put(' ', width - len);
+	}
+	w.put(title);
+	w.put(order);
+	if (left && width > len)
+	{	w.put(' ', width - len);
+	}
 }
 
 template<typename F>
-int formatter_t::print_header(const F &fn) const
+void formatter_t::print_header(misc::writer_t<F> &w) const
 {	if (flags_ & vi_tmHideHeader)
-	{	return 0;
+	{	return;
 	}
 
-	std::ostringstream str;
-	str <<
-		std::right << std::setw(max_len_number_) << TitleNumber << ". " <<
-		std::left << title(vi_tmSortByName) << std::right << ": ";
+	const auto start = w.size();
+	w.right(TitleNumber, max_len_number_);
+	w.put(". "sv);
+	print_title(vi_tmSortByName, w, true);
+	w.put(": "sv);
 
 #if VI_TM_STAT_USE_RAW
-	str << title(vi_tmSortByTime) << " / " << title(vi_tmSortByAmount) << " ~= ";
+	print_title(vi_tmSortByTime, w);
+	w.put(" / "sv);
+	print_title(vi_tmSortByAmount, w);
+	w.put(" ~= "sv);
 #endif
 
 #if VI_TM_STAT_USE_RAW || VI_TM_STAT_USE_RMSE
-	str << title(vi_tmSortBySpeed) << " ";
+	print_title(vi_tmSortBySpeed, w);
+	w.put(' ');
 #endif
 
 #if VI_TM_STAT_USE_RMSE
-	str << "+/- " << title(vi_tmSortByCV) << " ";
+	w.put("+/- "sv);
+	print_title(vi_tmSortByCV, w);
+	w.put(' ');
 #endif
 
 #if VI_TM_STAT_USE_MINMAX
-	str << "[" << title(vi_tmSortByMin) << " - " << title(vi_tmSortByMax) << "] ";
+	w.put('[');
+	print_title(vi_tmSortByMin, w);
+	w.put(" - "sv);
+	print_title(vi_tmSortByMax, w);
+	w.put("] "sv);
+#endif
+
+#if VI_TM_STAT_USE_CPUTIME
+	w.right(TitleCpu, max_len_cpu_);
+	w.put(" / "sv);
+	w.right(TitleOffCpu, max_len_off_cpu_);
+	w.put(' ');
+#endif
+
+#if VI_TM_STAT_USE_PERF
+	w.right(title_perf_, max_len_perf_);
+	w.put(' ');
+#endif
+
+#if VI_TM_STAT_USE_RUSAGE
+	for (unsigned n = 0; n < VI_TM_RUSAGE_COUNTERS; ++n)
+	{	w.right(TitleRusage[n], max_len_rusage_[n]);
+		w.put(' ');
+	}
 #endif
 
-	str << "\n";
-	const std::size_t len = str.tellp();
-	str << std::setfill('-') << std::setw(len - 1) << "\n";
-	return fn(str.str().c_str());
+	const auto len = w.size() - start;
+	w.end_line();
+	w.put('-', len - 1U);
+	w.end_line();
 }
 
 template<typename F>
-int formatter_t::print_footer(const F &fn) const
+void formatter_t::print_footer(misc::writer_t<F> &w) const
 {	if (flags_ & vi_tmHideHeader)
-	{	return 0;
+	{	return;
 	}
 	std::size_t cnt = (max_len_number_ + 2) + (width_column(vi_tmSortByName) + 2);
 #if VI_TM_STAT_USE_RAW
@@ -556,52 +818,80 @@ int formatter_t::print_footer(const F &fn) const
 #if VI_TM_STAT_USE_MINMAX
 	cnt += 1 + width_column(vi_tmSortByMin) + 3 + width_column(vi_tmSortByMax) + 2;
 #endif
+#if VI_TM_STAT_USE_CPUTIME
+	cnt += max_len_cpu_ + 3 + max_len_off_cpu_ + 1;
+#endif
+#if VI_TM_STAT_USE_PERF
+	cnt += max_len_perf_ + 1;
+#endif
+#if VI_TM_STAT_USE_RUSAGE
+	for (const auto len : max_len_rusage_) { cnt += len + 1; }
+#endif
 
-	std::string str(cnt, '-');
-	str.back() = '\n';
-	return fn(str.c_str());
+	w.put('-', cnt - 1);
+	w.end_line();
 }
 
 template<typename F>
-int formatter_t::print_metering(const metering_t &i, const F &fn) const
-{	std::ostringstream str;
-	str.imbue(std::locale(str.getloc(), new misc::space_out));
-
-	n_++;
+void formatter_t::print_metering(const metering_t &i, misc::writer_t<F> &w) const
+{	n_++;
 	const char fill_symbol = ((0U != guideline_interval_) &&
 		(0U == n_ % static_cast<std::size_t>(guideline_interval_))) ? UNDERSCORE : ' ';
 
-	str <<
-		std::setw(max_len_number_) << n_ << ". " <<
-		std::left << std::setfill(fill_symbol) <<
-		setw(vi_tmSortByName) << i.name_ << ": " <<
-		std::right << std::setfill(' ');
+	put_right(w, n_, max_len_number_);
+	w.put(". "sv);
+	w.left(i.name_, width_column(vi_tmSortByName), fill_symbol);
+	w.put(": "sv);
 
 #if VI_TM_STAT_USE_RAW
-	str << setw(vi_tmSortByTime) << i.sum_txt_ << " / " <<
-		setw(vi_tmSortByAmount) << i.cnt_ << " ~= ";
+	w.right(i.sum_txt_, width_column(vi_tmSortByTime));
+	w.put(" / "sv);
+	put_right(w, i.cnt_, width_column(vi_tmSortByAmount));
+	w.put(" ~= "sv);
 #endif
 
 #if VI_TM_STAT_USE_RAW || VI_TM_STAT_USE_RMSE
-	str << "" << setw(vi_tmSortBySpeed) << i.average_txt_ << " ";
+	w.right(i.average_txt_, width_column(vi_tmSortBySpeed));
+	w.put(' ');
 #endif
 
 #if VI_TM_STAT_USE_RMSE
-	str << (i.cv_txt_.empty() ? "    " : "+/- ") << setw(vi_tmSortByCV) << i.cv_txt_ << " ";
+	w.put(i.cv_txt_.empty() ? "    "sv : "+/- "sv);
+	w.right(i.cv_txt_, width_column(vi_tmSortByCV));
+	w.put(' ');
 #endif
 
 #if VI_TM_STAT_USE_MINMAX
-	str << "[" <<
-		setw(vi_tmSortByMin) << i.min_txt_ << " - " <<
-		setw(vi_tmSortByMax) << i.max_txt_ <<
-		"] ";
+	w.put('[');
+	w.right(i.min_txt_, width_column(vi_tmSortByMin));
+	w.put(" - "sv);
+	w.right(i.max_txt_, width_column(vi_tmSortByMax));
+	w.put("] "sv);
 #endif
 
-	str << "\n";
-	return fn(str.str().c_str());
+#if VI_TM_STAT_USE_CPUTIME
+	w.right(i.cpu_txt_, max_len_cpu_);
+	w.put(i.cpu_txt_.empty() ? "   "sv : " / "sv);
+	w.right(i.off_cpu_txt_, max_len_off_cpu_);
+	w.put(' ');
+#endif
+
+#if VI_TM_STAT_USE_PERF
+	w.right(i.perf_txt_, max_len_perf_);
+	w.put(' ');
+#endif
+
+#if VI_TM_STAT_USE_RUSAGE
+	for (unsigned n = 0; n < VI_TM_RUSAGE_COUNTERS; ++n)
+	{	put_right(w, i.rusage_[n], max_len_rusage_[n]);
+		w.put(' ');
+	}
+#endif
+
+	w.end_line();
 }
 
-VI_TM_RESULT VI_TM_CALL vi_tmRegistryReport(VI_TM_HREG registry_handle, VI_TM_FLAGS flags, vi_tmReportCb_t fn, void *ctx)
+VI_TM_RESULT VI_TM_CALL vi_tmRegistryReportEx(VI_TM_HREG registry_handle, VI_TM_FLAGS flags, VI_TM_SIZE top, const char *filter, vi_tmReportCb_t fn, void *ctx)
 {	assert(!ctx || !!fn);
 	if (nullptr == fn)
 	{	// Simulate the use of the registry to inhibit automatic report generation.
@@ -609,18 +899,37 @@ VI_TM_RESULT VI_TM_CALL vi_tmRegistryReport(VI_TM_HREG registry_handle, VI_TM_FL
 		return 0;
 	}
 
-	auto metering_entries = get_meterings(registry_handle, flags);
-	std::sort(metering_entries.begin(), metering_entries.end(), comparator_t{ flags });
+	auto entries = get_entries(registry_handle, flags, filter ? filter : "");
+	if (0U != top && top < entries.size())
+	{	// Only the first 'top' entries are ordered: O(N*log(top)) instead of O(N*log(N)).
+		const auto middle = entries.begin() + static_cast<std::ptrdiff_t>(top);
+		std::partial_sort(entries.begin(), middle, entries.end(), comparator_t{ flags });
+		entries.erase(middle, entries.end());
+	}
+	else
+	{	std::sort(entries.begin(), entries.end(), comparator_t{ flags });
+	}
+
+	std::vector<metering_t> metering_entries; // Only the printed rows are formatted.
+	metering_entries.reserve(entries.size());
+	for (auto &e : entries)
+	{	metering_entries.emplace_back(std::move(e.keys_), e.stats_);
+	}
 	const formatter_t formatter{ metering_entries, flags };
 	const auto prn = [fn, ctx](const char *str) { return fn(str, ctx); };
 
-	int result = print_props(prn, flags);
-	result += formatter.print_header(prn);
+	misc::writer_t w{ prn };
+	print_props(w, flags);
+	formatter.print_header(w);
 	for (const auto &itm : metering_entries)
-	{	result += formatter.print_metering(itm, prn);
+	{	formatter.print_metering(itm, w);
 	}
-	result += formatter.print_footer(prn);
-	return result;
+	formatter.print_footer(w);
+	return w.flush();
+}
+
+VI_TM_RESULT VI_TM_CALL vi_tmRegistryReport(VI_TM_HREG registry_handle, VI_TM_FLAGS flags, vi_tmReportCb_t fn, void *ctx)
+{	return vi_tmRegistryReportEx(registry_handle, flags, 0U, nullptr, fn, ctx);
 }
 
 VI_TM_RESULT VI_SYS_CALL vi_tmReportCb(const char *str, void* ignored)
@@ -636,3 +945,39 @@ VI_TM_RESULT VI_SYS_CALL vi_tmReportCb(const char *str, void* ignored)
 	assert(VI_SUCCEEDED(result));
 	return result;
 }
+
+VI_TM_RESULT VI_TM_CALL vi_tmBenchABReport(const char *name_a, const char *name_b, const vi_tmBenchABResult_t *r, vi_tmReportCb_t fn, void *ctx)
+{	if (!verify(!!name_a && !!name_b && !!r && !!fn))
+	{	return VI_FAILURE;
+	}
+
+	const auto prn = [fn, ctx](const char *str) { return fn(str, ctx); };
+	misc::writer_t w{ prn };
+	w.put(name_a);
+	w.put(": "sv);
+	w.put(to_cell(r->a_.mean_));
+	w.put(", "sv);
+	w.put(name_b);
+	w.put(": "sv);
+	w.put(to_cell(r->b_.mean_));
+	w.put(". Speedup: "sv);
+	w.put(to_ratio(r->speedup_));
+	w.put(" [95% CI "sv);
+	w.put(to_ratio(r->speedup_lo_));
+	w.put(".."sv);
+	w.put(to_ratio(r->speedup_hi_));
+	w.put("], t = "sv);
+	w.put_num(std::round(r->t_ * 10.0) / 10.0);
+	w.put(", df = "sv);
+	w.put_num(static_cast<unsigned>(std::lround(r->df_)));
+	w.put(". "sv);
+	if (0 == r->verdict_)
+	{	w.put("Not significant."sv);
+	}
+	else
+	{	w.put(name_b);
+		w.put(r->verdict_ > 0 ? " is faster."sv : " is slower."sv);
+	}
+	w.end_line();
+	return w.flush();
+}
@@ -0,0 +1,174 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+/*****************************************************************************\
+* This file is part of the vi_timing library.
+*
+* vi_timing - a compact, lightweight C/C++ library for measuring code
+* execution time. It was developed for experimental and educational purposes,
+* so please keep expectations reasonable.
+*
+* Report bugs or suggest improvements to author: <programmer.amateur@proton.me>
+*
+* LICENSE & DISCLAIMER:
+* - No warranties. Use at your own risk.
+* - Licensed under Business Source License 1.1 (BSL-1.1):
+*   - Free for non-commercial use.
+*   - For commercial licensing, contact the author.
+*   - Change Date: 2029-09-01 - after which the library will be licensed
+*     under GNU GPLv3.
+*   - Attribution required: "vi_timing Library (c) A.Prograamar".
+*   - See LICENSE in the project root for full terms.
+\*****************************************************************************/
+
+#include "build_number_generator.h"
+#include "misc.h"
+#include "shm.h"
+#include <vi_timing/vi_timing.h>
+#include <vi_timing/vi_timing_aux.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#	include <fcntl.h> // For O_* constants.
+#	include <signal.h> // For kill.
+#	include <sys/mman.h> // For shm_open, mmap.
+#	include <sys/stat.h> // For fstat.
+#	include <unistd.h> // For ftruncate, getpid.
+#	define VI_TM_HAS_SHM 1
+#else
+#	define VI_TM_HAS_SHM 0
+#endif
+
+using namespace std::literals;
+
+#if VI_TM_HAS_SHM
+namespace
+{
+	// True if the existing page was left by a process that has exited. A page whose header is not initialized yet
+	// may belong to a process that is creating it right now, so it is not considered stale.
+	bool is_stale(const char *name) noexcept
+	{	const auto fd = shm_open(name, O_RDONLY, 0);
+		if (fd < 0)
+		{	return ENOENT == errno; // Removed meanwhile.
+		}
+
+		bool result = false;
+		struct stat st{};
+		if (0 == fstat(fd, &st) && static_cast<std::size_t>(st.st_size) >= sizeof(vi_tmShmHeader_t))
+		{	if (const auto addr = mmap(nullptr, sizeof(vi_tmShmHeader_t), PROT_READ, MAP_SHARED, fd, 0); MAP_FAILED != addr)
+			{	const auto header = static_cast<const vi_tmShmHeader_t *>(addr);
+				if (VI_TM_SHM_MAGIC == shm::as_atomic(header->magic_).load(std::memory_order_acquire))
+				{	const auto pid = static_cast<pid_t>(header->pid_);
+					result = pid != getpid() && 0 != kill(pid, 0) && ESRCH == errno;
+				}
+				munmap(addr, sizeof(vi_tmShmHeader_t));
+			}
+		}
+		close(fd);
+		return result;
+	}
+}
+#endif
+
+shm::page_t::~page_t()
+{
+#if VI_TM_HAS_SHM
+	if (header_)
+	{	verify(0 == munmap(header_, size_));
+		verify(0 == shm_unlink(name_.c_str()));
+	}
+#endif
+}
+
+std::unique_ptr<shm::page_t> shm::page_t::create(const char *name, std::size_t capacity)
+{	std::unique_ptr<page_t> result;
+#if VI_TM_HAS_SHM
+	if (!verify(!!name && *name && capacity > 0U && capacity <= UINT32_MAX))
+	{	return result;
+	}
+
+	result.reset(new page_t);
+	result->name_ = ('/' == *name) ? name : "/"s + name;
+	result->size_ = sizeof(vi_tmShmHeader_t) + capacity * sizeof(vi_tmShmSlot_t);
+
+	// The page of another live process is never truncated: only a stale one is removed and created anew.
+	auto fd = shm_open(result->name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	if (fd < 0 && EEXIST == errno && is_stale(result->name_.c_str()))
+	{	shm_unlink(result->name_.c_str());
+		fd = shm_open(result->name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	}
+	errno = 0; // The failures above are either handled or reported by the result.
+	if (fd < 0)
+	{	return nullptr;
+	}
+
+	void *addr = MAP_FAILED;
+	if (0 == ftruncate(fd, static_cast<off_t>(result->size_)))
+	{	addr = mmap(nullptr, result->size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (MAP_FAILED == addr)
+	{	shm_unlink(result->name_.c_str());
+		errno = 0;
+		return nullptr;
+	}
+
+	// The file is zero-filled by ftruncate, so all slots start with an even sequence counter and an empty name.
+	const auto &props = misc::properties_t::props();
+	auto header = static_cast<vi_tmShmHeader_t *>(addr);
+	header->version_ = VI_TM_SHM_VERSION;
+	header->flags_ = *static_cast<const unsigned *>(vi_tmStaticInfo(vi_tmInfoFlags));
+	header->slot_size_ = static_cast<std::uint32_t>(sizeof(vi_tmShmSlot_t));
+	header->capacity_ = static_cast<std::uint32_t>(capacity);
+	header->count_ = 0U;
+	header->pid_ = static_cast<std::uint32_t>(getpid());
+	header->seconds_per_tick_ = props.seconds_per_tick_.count();
+	header->overhead_ticks_ = props.clock_overhead_ticks_;
+	as_atomic(header->magic_).store(VI_TM_SHM_MAGIC, std::memory_order_release); // The header is ready.
+	result->header_ = header;
+#else
+	(void)name;
+	(void)capacity;
+#endif
+	return result;
+}
+
+vi_tmShmSlot_t *shm::page_t::allocate(const char *name) noexcept
+{	assert(header_ && name);
+	const auto n = header_->count_;
+	if (n >= header_->capacity_)
+	{	return nullptr;
+	}
+
+	auto const result = reinterpret_cast<vi_tmShmSlot_t *>(header_ + 1) + n;
+	const auto len = std::min<std::size_t>(std::strlen(name), VI_TM_SHM_NAME_SIZE - 1U);
+	std::memcpy(result->name_, name, len);
+	result->name_[len] = '\0';
+	vi_tmStatsReset(&result->stats_);
+	as_atomic(header_->count_).store(n + 1U, std::memory_order_release); // The slot name is visible to readers.
+	return result;
+}
+
+VI_TM_RESULT VI_TM_CALL vi_tmShmSlotLoad(const vi_tmShmSlot_t *slot, vi_tmStats_t *dst) noexcept
+{	if (!verify(!!slot && !!dst))
+	{	return VI_FAILURE;
+	}
+
+	const auto &seq = shm::as_atomic(slot->seq_);
+	for (VI_TM_RESULT retries = 0; retries < VI_TM_SHM_MAX_RETRIES; ++retries)
+	{	const auto s1 = seq.load(std::memory_order_acquire);
+		if (0U == (s1 & 1U))
+		{	std::memcpy(dst, &slot->stats_, sizeof(*dst));
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (seq.load(std::memory_order_relaxed) == s1)
+			{	return retries;
+			}
+		}
+		vi_ThreadYield();
+	}
+	return VI_FAILURE; // The slot stays locked: the writer has probably died in the middle of an update.
+}
@@ -0,0 +1,52 @@
+#ifndef VI_TIMING_SOURCE_SHM_H
+#	define VI_TIMING_SOURCE_SHM_H
+#	pragma once
+
+#include <vi_timing/vi_timing_shm.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+namespace shm
+{
+	static_assert(sizeof(std::atomic<std::uint64_t>) == sizeof(std::uint64_t) && std::atomic<std::uint64_t>::is_always_lock_free);
+	static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t) && std::atomic<std::uint32_t>::is_always_lock_free);
+
+	template<typename T>
+	auto& as_atomic(T &v) noexcept { return *reinterpret_cast<std::atomic<T>*>(&v); }
+	template<typename T>
+	const auto& as_atomic(const T &v) noexcept { return *reinterpret_cast<const std::atomic<T>*>(&v); }
+
+	// Seqlock writer. Callers must serialize writes to the same slot (meterage_t does it with its own mutex).
+	inline void publish(vi_tmShmSlot_t *slot, const vi_tmStats_t &stats) noexcept
+	{	auto &seq = as_atomic(slot->seq_);
+		const auto s = seq.load(std::memory_order_relaxed);
+		seq.store(s + 1U, std::memory_order_relaxed); // Odd: update in progress.
+		std::atomic_thread_fence(std::memory_order_release);
+		std::memcpy(&slot->stats_, &stats, sizeof(stats));
+		seq.store(s + 2U, std::memory_order_release);
+	}
+
+	// page_t: Owner of the shared-memory page that mirrors a registry.
+	// Slots are handed out by allocate() under the registry's storage guard.
+	class page_t
+	{	std::string name_;
+		vi_tmShmHeader_t *header_ = nullptr;
+		std::size_t size_ = 0U;
+
+		page_t() = default;
+	public:
+		page_t(const page_t &) = delete;
+		page_t &operator=(const page_t &) = delete;
+		~page_t();
+
+		static std::unique_ptr<page_t> create(const char *name, std::size_t capacity);
+		vi_tmShmSlot_t *allocate(const char *name) noexcept; // Returns nullptr if the page is full.
+	};
+}
+
+#endif // #ifndef VI_TIMING_SOURCE_SHM_H
@@ -23,10 +23,13 @@
 
 #include "build_number_generator.h" // For build number generation.
 #include "misc.h"
+#include "shm.h"
 #include <vi_timing/vi_timing.h>
 
 #include <algorithm> // std::min_element, std::max_element
+#include <atomic> // std::atomic
 #include <cassert> // assert()
+#include <climits> // UINT_MAX
 #include <chrono> // std::chrono::milliseconds
 #include <cmath> // std::sqrt
 #include <cstdint> // std::uint64_t, std::size_t
@@ -36,8 +39,10 @@
 #include <new>
 #include <numeric> // std::accumulate
 #include <string> // std::string
+#include <string_view>
 #include <unordered_map> // unordered_map: "does not invalidate pointers or references to elements".
 #include <utility>
+#include <vector>
 
 #if !VI_TM_STAT_USE_RMSE && VI_TM_STAT_USE_FILTER
 #	error "The filter is only available when RMSE is enabled."
@@ -128,6 +133,17 @@ namespace
 	constexpr std::size_t hardware_constructive_interference_size = 64;
 #endif
 
+#if VI_TM_THREADSAFE
+	using epoch_t = std::atomic<std::uint32_t>;
+#else
+	using epoch_t = std::uint32_t;
+#endif
+
+	// The generation of a measurement cell (see cell_t); a handle holds it in the bits above the index of the cell.
+	using generation_t = std::uintptr_t;
+	constexpr unsigned CELL_INDEX_BITS = sizeof(std::uintptr_t) >= 8U ? 24U : 20U; // Up to 16M (1M on 32-bit platforms) live and removed measurements in all registries.
+	constexpr generation_t GENERATION_MAX = ~generation_t{ 0U } >> CELL_INDEX_BITS; // Generations wrap after 2^40 (4095 on 32-bit platforms) reuses of a cell.
+
 	/// <summary>
 	/// meterage_t is a class for collecting and managing timing measurement statistics.
 	/// </summary>
@@ -145,8 +161,18 @@ namespace
 	///   <item><description>merge()  : Merge statistics from another structure.</description></item>
 	///   <item><description>get()    : Get the current statistics.</description></item>
 	///   <item><description>reset()  : Reset all statistics.</description></item>
+	///   <item><description>mirror() : Attach a slot of the live statistics page (see vi_timing_shm.h).</description></item>
+	///   <item><description>idle()   : Count eviction cycles without new calls.</description></item>
+	///   <item><description>recycle(): Outdate the handles and clear the measurement for reuse.</description></item>
 	/// </list>
 	/// <para>
+	/// The methods called through a handle take its generation and ignore the call if the measurement has since been recycled.
+	/// </para>
+	/// <para>
+	/// A registry-wide reset only increments the registry epoch (see assign()); the statistics
+	/// of a measurement are cleared on its next update, and get() reports them as empty until then.
+	/// </para>
+	/// <para>
 	/// <b>Thread safety:</b> All methods are thread-safe only if the macro <c>VI_TM_THREADSAFE</c> is defined and set to a nonzero value.
 	/// In this case, access to the data is protected by an adaptive mutex.
 	/// The class is aligned to the hardware cache line size to minimize false sharing in multithreaded scenarios.
@@ -155,28 +181,73 @@ namespace
 	{	static_assert(std::is_standard_layout_v<vi_tmStats_t>); // Ensure standard layout for compatibility with C.
 		vi_tmStats_t stats_;
 		VI_TM_THREADSAFE_ONLY(mutable adaptive_mutex_t mtx_);
+		generation_t gen_ = 1U; // Handles of other generations are outdated. Changed only by recycle().
+		std::uint32_t epoch_ = 0U; // The registry epoch to which stats_ belongs.
+		const epoch_t *registry_epoch_ = nullptr; // The epoch of the owning registry; nullptr if the measurement is free.
+		vi_tmShmSlot_t *slot_ = nullptr; // Mirror of stats_ in the live statistics page; nullptr if not mirrored.
+		VI_TM_SIZE seen_calls_ = 0U; // Value of stats_.calls_ at the last eviction cycle. Guarded by the registry's storage guard.
+		unsigned idle_cycles_ = 0U; // Number of consecutive eviction cycles without new calls. Guarded by the registry's storage guard.
+		std::string name_; // Assigned only while no handle of the current generation exists.
+
+		bool expired() const noexcept { return registry_epoch_ && epoch_ != *registry_epoch_; }
+		void sync() noexcept; // Applies a pending registry-wide reset. Must be called under mtx_.
 	public:
 		meterage_t() noexcept { vi_tmStatsReset(&stats_); }
-		void add(VI_TM_TDIFF val, VI_TM_SIZE cnt) noexcept;
-		void merge(const vi_tmStats_t &src) noexcept;
-		vi_tmStats_t get() const noexcept;
-		void reset() noexcept;
+		void assign(const char *name, const epoch_t *epoch); // Names a free measurement and attaches the registry epoch, before the handle is published.
+		void recycle() noexcept;
+		generation_t generation() const noexcept { return gen_; } // Call under the storage guard of the owning registry.
+		const std::string& name() const noexcept { return name_; } // Call under the storage guard of the owning registry.
+		bool owned_by(generation_t gen, const epoch_t *epoch) const noexcept; // Whether the handle is current and the measurement belongs to the registry.
+		void add(generation_t gen, VI_TM_TDIFF val, VI_TM_SIZE cnt) noexcept;
+		void add(generation_t gen, VI_TM_TDIFF val, const vi_tmCounters_t &ctr, VI_TM_SIZE cnt) noexcept;
+		void merge(generation_t gen, const vi_tmStats_t &src) noexcept;
+		bool get(generation_t gen, const char **name, vi_tmStats_t *stats) const noexcept; // Returns false if the handle is outdated.
+		void reset(generation_t gen) noexcept;
+		void mirror(vi_tmShmSlot_t *slot) noexcept;
+		unsigned idle() noexcept; // Starts a new eviction cycle; returns the number of consecutive cycles without new calls.
 	};
 
-	using storage_t = std::unordered_map<std::string, meterage_t>;
+	// A measurement cell. Its memory is never freed: a reclaimed cell gets a new generation and is reused, so the handles
+	// cached anywhere (e.g. in static variables by the VI_TM macros) stay safe to use, and the outdated ones are ignored.
+	struct cell_t
+	{	meterage_t meter_;
+		std::uint32_t index_ = 0U; // Position in cells_t, the low bits of the handle.
+		cell_t *next_ = nullptr; // The next free cell. Guarded by the guard of cells_t.
+		VI_TM_HMEAS handle() const noexcept // Call under the storage guard of the owning registry.
+		{	return reinterpret_cast<VI_TM_HMEAS>((meter_.generation() << CELL_INDEX_BITS) | index_);
+		}
+	};
+
+	// The cells of all registries, in chunks that are allocated on demand and never freed.
+	// All-zero is the initial state, so it needs no dynamic initialization and can be used during the initialization of other statics.
+	class cells_t
+	{	static constexpr unsigned CHUNK_BITS = 8U;
+		static constexpr std::uint32_t CHUNK_SIZE = 1U << CHUNK_BITS;
+		static constexpr std::uint32_t MAX_CELLS = 1U << CELL_INDEX_BITS;
+#if VI_TM_THREADSAFE
+		using chunk_ptr_t = std::atomic<cell_t *>; // Read without the guard.
+#else
+		using chunk_ptr_t = cell_t *;
+#endif
+		chunk_ptr_t chunks_[MAX_CELLS / CHUNK_SIZE]{};
+		std::uint32_t size_ = 0U; // Number of constructed cells.
+		cell_t *head_ = nullptr; // The free cells are reused in FIFO order, so that their generations wrap as late as possible.
+		cell_t *tail_ = nullptr;
+		VI_TM_THREADSAFE_ONLY(adaptive_mutex_t guard_);
+	public:
+		cell_t* at(VI_TM_HMEAS meas, generation_t &gen) const noexcept; // Returns nullptr if the handle was never issued.
+		cell_t& allocate(); // Throws std::bad_alloc if all the cells are in use.
+		void release(cell_t &cell) noexcept; // Recycles the cell and puts it to the free list.
+	};
+	cells_t cells;
+
+	using storage_t = std::unordered_map<std::string_view, cell_t *>; // The keys refer to the names of the cells.
 	using jrn_finalizer_ctx_t = void*;
 	using jrn_finalizer_fn_t = int(*)(vi_tmRegistry_t*, jrn_finalizer_ctx_t);
 	using jrn_finalizer_t = std::pair<jrn_finalizer_fn_t, jrn_finalizer_ctx_t>;
 }
 
-// 'vi_tmMeasurement_t' is simply an alias for a measurement entry in the storage map.
-// It inherits from 'storage_t::value_type', which is typically 'std::pair<const std::string, meterage_t>'.
-struct vi_tmMeasurement_t: storage_t::value_type {/**/};
-static_assert
-	(	sizeof(vi_tmMeasurement_t) == sizeof(storage_t::value_type) &&
-		alignof(vi_tmMeasurement_t) == alignof(storage_t::value_type),
-		"'vi_tmMeasurement_t' should simply be a synonym for 'storage_t::value_type'."
-	);
+// 'vi_tmMeasurement_t' is never defined: a handle is not a pointer, but the index of a cell combined with its generation (see cell_t).
 
 struct vi_tmRegistry_t
 {
@@ -184,15 +255,25 @@ private:
 	static constexpr auto MAX_LOAD_FACTOR = 0.7F;
 	static constexpr size_t DEFAULT_STORAGE_CAPACITY = 64U;
 protected:
+	std::unique_ptr<shm::page_t> shm_; // Live statistics page; declared before storage_ to outlive the slot pointers.
 	storage_t storage_;
+	epoch_t epoch_{ 0U }; // Incremented by reset(); measurements of older epochs are cleared lazily.
+	storage_t retired_; // Removed measurements; they are revived by try_emplace() until reclaim() recycles their cells.
 	VI_TM_THREADSAFE_ONLY(mutable adaptive_mutex_t storage_guard_);
 public:
 	vi_tmRegistry_t(const vi_tmRegistry_t &) = delete;
 	vi_tmRegistry_t& operator=(const vi_tmRegistry_t &) = delete;
 	vi_tmRegistry_t();
-	~vi_tmRegistry_t() = default;
-	auto& try_emplace(const char *name); // Get a reference to the measurement by name, creating it if it does not exist.
+	~vi_tmRegistry_t(); // Recycles all the cells, so the handles of the registry are ignored from now on.
+	VI_TM_HMEAS try_emplace(const char *name); // Get a handle to the measurement by name, creating (or reviving a removed) it if it does not exist.
 	int for_each_measurement(vi_tmMeasEnumCb_t fn, void *ctx); // Calls the function fn for each measurement in the registry, while this function returns 0. Returns the return code of the function fn if it returned a nonzero value, or 0 if all measurements were processed.
+	int mirror(const char *name, std::size_t capacity); // Starts mirroring into the live statistics page 'name', or stops it if name is nullptr.
+	int remove(VI_TM_HMEAS meas); // Moves the measurement to the retired list. Its handle remains current.
+	int evict_idle(unsigned cycles); // Removes measurements that have had no new calls for 'cycles' consecutive calls of this function.
+	int reclaim(); // Recycles the cells of the removed measurements; their handles become outdated.
+	void reset() noexcept { ++epoch_; } // Resets all measurements in constant time.
+private:
+	void retire(storage_t::const_iterator it);
 };
 
 vi_tmRegistry_t::vi_tmRegistry_t()
@@ -200,31 +281,213 @@ vi_tmRegistry_t::vi_tmRegistry_t()
 	storage_.reserve(DEFAULT_STORAGE_CAPACITY);
 }
 
-inline void meterage_t::reset() noexcept
+vi_tmRegistry_t::~vi_tmRegistry_t()
+{	for (auto &it : storage_)
+	{	cells.release(*it.second);
+	}
+	for (auto &it : retired_)
+	{	cells.release(*it.second);
+	}
+}
+
+inline cell_t* cells_t::at(VI_TM_HMEAS meas, generation_t &gen) const noexcept
+{	const auto value = reinterpret_cast<std::uintptr_t>(meas);
+	const auto index = static_cast<std::uint32_t>(value & (MAX_CELLS - 1U));
+	gen = value >> CELL_INDEX_BITS;
+	cell_t *const chunk = chunks_[index >> CHUNK_BITS];
+	return chunk ? chunk + (index & (CHUNK_SIZE - 1U)) : nullptr;
+}
+
+cell_t& cells_t::allocate()
+{	VI_TM_THREADSAFE_ONLY(std::lock_guard lock{ guard_ });
+	if (head_)
+	{	auto &result = *head_;
+		head_ = result.next_;
+		if (!head_)
+		{	tail_ = nullptr;
+		}
+		return result;
+	}
+
+	if (size_ >= MAX_CELLS)
+	{	throw std::bad_alloc{};
+	}
+	if (0U == size_ % CHUNK_SIZE)
+	{	const auto chunk = new cell_t[CHUNK_SIZE];
+		for (std::uint32_t n = 0U; n < CHUNK_SIZE; ++n)
+		{	chunk[n].index_ = size_ + n;
+		}
+		chunks_[size_ / CHUNK_SIZE] = chunk; // Published with the indices set.
+	}
+	cell_t *const chunk = chunks_[size_ / CHUNK_SIZE];
+	return chunk[size_++ % CHUNK_SIZE];
+}
+
+void cells_t::release(cell_t &cell) noexcept
+{	cell.meter_.recycle();
+	VI_TM_THREADSAFE_ONLY(std::lock_guard lock{ guard_ });
+	cell.next_ = nullptr;
+	(tail_ ? tail_->next_ : head_) = &cell;
+	tail_ = &cell;
+}
+
+inline void meterage_t::sync() noexcept
+{	if (registry_epoch_)
+	{	if (const std::uint32_t epoch = *registry_epoch_; epoch != epoch_)
+		{	epoch_ = epoch;
+			vi_tmStatsReset(&stats_);
+		}
+	}
+}
+
+inline void meterage_t::assign(const char *name, const epoch_t *epoch)
+{	assert(name && epoch && !registry_epoch_);
+	// No handle of the current generation exists yet, so other threads do not read these fields.
+	name_ = name;
+	registry_epoch_ = epoch;
+	epoch_ = *epoch;
+}
+
+inline void meterage_t::recycle() noexcept
+{	VI_TM_THREADSAFE_ONLY(std::lock_guard lg(mtx_));
+	gen_ = (gen_ < GENERATION_MAX) ? gen_ + 1U : 1U;
+	vi_tmStatsReset(&stats_);
+	registry_epoch_ = nullptr;
+	slot_ = nullptr; // The slots of a page cannot be freed.
+	seen_calls_ = 0U;
+	idle_cycles_ = 0U;
+	std::string{}.swap(name_);
+}
+
+inline bool meterage_t::owned_by(generation_t gen, const epoch_t *epoch) const noexcept
+{	VI_TM_THREADSAFE_ONLY(std::lock_guard lg(mtx_));
+	return gen == gen_ && epoch == registry_epoch_;
+}
+
+inline void meterage_t::reset(generation_t gen) noexcept
 {	VI_TM_THREADSAFE_ONLY(std::lock_guard lg(mtx_));
+	if (gen != gen_)
+	{	return;
+	}
+	if (registry_epoch_)
+	{	epoch_ = *registry_epoch_;
+	}
 	vi_tmStatsReset(&stats_);
+	if (slot_) { shm::publish(slot_, stats_); }
 }
 
-inline void meterage_t::add(VI_TM_TDIFF v, VI_TM_SIZE n) noexcept
+inline void meterage_t::add(generation_t gen, VI_TM_TDIFF v, VI_TM_SIZE n) noexcept
 {	VI_TM_THREADSAFE_ONLY(std::lock_guard lg(mtx_));
+	if (gen != gen_)
+	{	return;
+	}
+	sync();
 	vi_tmStatsAdd(&stats_, v, n);
+	if (slot_) { shm::publish(slot_, stats_); }
+}
+
+inline void meterage_t::add(generation_t gen, VI_TM_TDIFF v, const vi_tmCounters_t &ctr, VI_TM_SIZE n) noexcept
+{	(void)ctr;
+	VI_TM_THREADSAFE_ONLY(std::lock_guard lg(mtx_));
+	if (gen != gen_)
+	{	return;
+	}
+	sync();
+	vi_tmStatsAdd(&stats_, v, n);
+	if (0U != n)
+	{
+#if VI_TM_STAT_USE_CPUTIME
+		stats_.cpu_ += ctr.cpu_;
+#endif
+#if VI_TM_STAT_USE_PERF
+		for (unsigned i = 0; i < VI_TM_PERF_COUNTERS; ++i) { stats_.perf_[i] += ctr.perf_[i]; }
+#endif
+#if VI_TM_STAT_USE_RUSAGE
+		for (unsigned i = 0; i < VI_TM_RUSAGE_COUNTERS; ++i) { stats_.rusage_[i] += ctr.rusage_[i]; }
+#endif
+	}
+	if (slot_) { shm::publish(slot_, stats_); }
 }
 
-inline void meterage_t::merge(const vi_tmStats_t &src) noexcept
+inline void meterage_t::merge(generation_t gen, const vi_tmStats_t &src) noexcept
 {	VI_TM_THREADSAFE_ONLY(std::lock_guard lg(mtx_));
+	if (gen != gen_)
+	{	return;
+	}
+	sync();
 	vi_tmStatsMerge(&stats_, &src);
+	if (slot_) { shm::publish(slot_, stats_); }
+}
+
+inline void meterage_t::mirror(vi_tmShmSlot_t *slot) noexcept
+{	VI_TM_THREADSAFE_ONLY(std::lock_guard lg(mtx_));
+	sync();
+	slot_ = slot;
+	if (slot_) { shm::publish(slot_, stats_); }
 }
 
-inline vi_tmStats_t meterage_t::get() const noexcept
+inline bool meterage_t::get(generation_t gen, const char **name, vi_tmStats_t *stats) const noexcept
 {	VI_TM_THREADSAFE_ONLY(std::lock_guard lg(mtx_));
-	return stats_;
+	if (gen != gen_)
+	{	return false;
+	}
+	if (name)
+	{	*name = name_.c_str();
+	}
+	if (stats)
+	{	if (expired())
+		{	vi_tmStatsReset(stats);
+		}
+		else
+		{	*stats = stats_;
+		}
+	}
+	return true;
 }
 
-inline auto& vi_tmRegistry_t::try_emplace(const char *name)
+inline unsigned meterage_t::idle() noexcept
+{	vi_tmStats_t stats;
+	verify(get(gen_, nullptr, &stats));
+	const auto calls = stats.calls_;
+	if (calls != seen_calls_)
+	{	seen_calls_ = calls;
+		idle_cycles_ = 0U;
+	}
+	else if (idle_cycles_ < UINT_MAX)
+	{	++idle_cycles_;
+	}
+	return idle_cycles_;
+}
+
+inline VI_TM_HMEAS vi_tmRegistry_t::try_emplace(const char *name)
 {	assert(name);
 	VI_TM_THREADSAFE_ONLY(std::lock_guard lock{ storage_guard_ });
-	auto [iterator, _] = storage_.try_emplace(name);
-	return *iterator;
+	if (const auto it = storage_.find(name); storage_.end() != it)
+	{	return it->second->handle();
+	}
+
+	cell_t *cell = nullptr;
+	if (auto node = retired_.extract(name); !node.empty())
+	{	// Revive the removed measurement, so that its cached handles and the new one are the same.
+		cell = node.mapped();
+		storage_.insert(std::move(node));
+		cell->meter_.idle(); // Restart idle counting from the current number of calls.
+	}
+	else
+	{	cell = &cells.allocate();
+		try
+		{	cell->meter_.assign(name, &epoch_);
+			storage_.emplace(cell->meter_.name(), cell);
+		}
+		catch (const std::bad_alloc &)
+		{	cells.release(*cell);
+			throw;
+		}
+	}
+	if (shm_ && *name)
+	{	cell->meter_.mirror(shm_->allocate(name));
+	}
+	return cell->handle();
 }
 
 int vi_tmRegistry_t::for_each_measurement(vi_tmMeasEnumCb_t fn, void *ctx)
@@ -232,7 +495,7 @@ int vi_tmRegistry_t::for_each_measurement(vi_tmMeasEnumCb_t fn, void *ctx)
 	assert(fn);
 	for (auto &it : storage_)
 	{	if (!it.first.empty())
-		{	if (const auto breaker = fn(static_cast<VI_TM_HMEAS>(&it), ctx))
+		{	if (const auto breaker = fn(it.second->handle(), ctx))
 			{	return breaker;
 			}
 		}
@@ -240,6 +503,73 @@ int vi_tmRegistry_t::for_each_measurement(vi_tmMeasEnumCb_t fn, void *ctx)
 	return 0;
 }
 
+int vi_tmRegistry_t::mirror(const char *name, std::size_t capacity)
+{	VI_TM_THREADSAFE_ONLY(std::lock_guard lock{ storage_guard_ });
+	std::unique_ptr<shm::page_t> page;
+	if (name)
+	{	try
+		{	page = shm::page_t::create(name, capacity);
+		}
+		catch (const std::bad_alloc &)
+		{	assert(false);
+		}
+		if (!page)
+		{	return VI_FAILURE;
+		}
+	}
+
+	for (auto &it : storage_)
+	{	it.second->meter_.mirror(page && !it.first.empty() ? page->allocate(it.second->meter_.name().c_str()) : nullptr);
+	}
+	shm_ = std::move(page); // The previous page (if any) is no longer referenced and is removed.
+	return VI_SUCCESS;
+}
+
+void vi_tmRegistry_t::retire(storage_t::const_iterator it)
+{	auto node = storage_.extract(it);
+	node.mapped()->meter_.mirror(nullptr); // Slots of the page cannot be freed; the revived measurement gets a new one.
+	verify(retired_.insert(std::move(node)).inserted); // Names are unique in both maps.
+}
+
+int vi_tmRegistry_t::remove(VI_TM_HMEAS meas)
+{	generation_t gen = 0U;
+	const auto cell = cells.at(meas, gen);
+	VI_TM_THREADSAFE_ONLY(std::lock_guard lock{ storage_guard_ });
+	if (!cell || !cell->meter_.owned_by(gen, &epoch_))
+	{	return VI_FAILURE; // Outdated or belongs to another registry.
+	}
+	const auto it = storage_.find(cell->meter_.name());
+	if (storage_.end() == it)
+	{	return VI_FAILURE; // Already removed.
+	}
+	assert(it->second == cell);
+	retire(it);
+	return VI_SUCCESS;
+}
+
+int vi_tmRegistry_t::evict_idle(unsigned cycles)
+{	VI_TM_THREADSAFE_ONLY(std::lock_guard lock{ storage_guard_ });
+	int result = 0;
+	for (auto it = storage_.begin(); it != storage_.end(); )
+	{	const auto current = it++;
+		if (current->second->meter_.idle() >= cycles && !current->first.empty())
+		{	retire(current);
+			++result;
+		}
+	}
+	return result;
+}
+
+int vi_tmRegistry_t::reclaim()
+{	VI_TM_THREADSAFE_ONLY(std::lock_guard lock{ storage_guard_ });
+	const auto result = static_cast<int>(retired_.size());
+	for (auto &it : retired_)
+	{	cells.release(*it.second); // The handles of the measurement are outdated from now on.
+	}
+	storage_t{}.swap(retired_); // Also releases the bucket array.
+	return result;
+}
+
 //vvvv API Implementation vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
 
 #if VI_TM_STAT_USE_MINMAX
@@ -326,6 +656,15 @@ void VI_TM_CALL vi_tmStatsReset(vi_tmStats_t *meas) noexcept
 	meas->min_ = VI_TM_FP_POSITIVE_INF;
 	meas->max_ = VI_TM_FP_NEGATIVE_INF;
 #endif
+#if VI_TM_STAT_USE_CPUTIME
+	meas->cpu_ = 0U;
+#endif
+#if VI_TM_STAT_USE_PERF
+	std::fill(std::begin(meas->perf_), std::end(meas->perf_), VI_TM_TDIFF{ 0U });
+#endif
+#if VI_TM_STAT_USE_RUSAGE
+	std::fill(std::begin(meas->rusage_), std::end(meas->rusage_), VI_TM_TDIFF{ 0U });
+#endif
 #if VI_TM_STAT_USE_RMSE
 	meas->flt_calls_ = 0U;
 	meas->flt_cnt_ = fp_ZERO;
@@ -416,6 +755,15 @@ void VI_TM_CALL vi_tmStatsMerge(vi_tmStats_t* VI_RESTRICT dst, const vi_tmStats_
 	{	dst->max_ = src->max_;
 	}
 #endif
+#if VI_TM_STAT_USE_CPUTIME
+	dst->cpu_ += src->cpu_;
+#endif
+#if VI_TM_STAT_USE_PERF
+	for (unsigned i = 0; i < VI_TM_PERF_COUNTERS; ++i) { dst->perf_[i] += src->perf_[i]; }
+#endif
+#if VI_TM_STAT_USE_RUSAGE
+	for (unsigned i = 0; i < VI_TM_RUSAGE_COUNTERS; ++i) { dst->rusage_[i] += src->rusage_[i]; }
+#endif
 #if VI_TM_STAT_USE_RMSE
 	if (src->flt_cnt_ > fp_ZERO)
 	{	const auto new_cnt_reverse = fp_ONE / (dst->flt_cnt_ + src->flt_cnt_);
@@ -446,33 +794,166 @@ void VI_TM_CALL vi_tmRegistryClose(VI_TM_HREG registry)
 }
 
 void VI_TM_CALL vi_tmRegistryReset(VI_TM_HREG registry) noexcept
-{	vi_tmRegistryEnumerateMeas(registry, [](VI_TM_HMEAS m, void *) { vi_tmMeasurementReset(m); return 0; }, nullptr);
+{	misc::from_handle(registry)->reset();
 }
 
 int VI_TM_CALL vi_tmRegistryEnumerateMeas(VI_TM_HREG registry, vi_tmMeasEnumCb_t fn, void *ctx)
 {	return misc::from_handle(registry)->for_each_measurement(fn, ctx);
 }
 
+VI_TM_RESULT VI_TM_CALL vi_tmRegistryMerge(VI_TM_HREG dst, VI_TM_HREG src)
+{	auto const d = misc::from_handle(dst);
+	auto const s = misc::from_handle(src);
+	if (!verify(!!d && !!s && d != s))
+	{	return VI_FAILURE;
+	}
+
+	// The source is copied first, so the two registries are never locked together.
+	// The names are copied too: once the source guard is released, its entries may be removed or evicted.
+	std::vector<std::pair<std::string, vi_tmStats_t>> entries;
+	try
+	{	s->for_each_measurement
+		(	[](VI_TM_HMEAS m, void *ctx)
+			{	const char *name = nullptr;
+				vi_tmStats_t stats;
+				vi_tmMeasurementGet(m, &name, &stats);
+				if (0U != stats.calls_) // Otherwise, nothing to merge.
+				{	static_cast<decltype(entries) *>(ctx)->emplace_back(name, stats);
+				}
+				return 0;
+			},
+			&entries
+		);
+
+		for (auto &[name, stats] : entries)
+		{	vi_tmMeasurementMerge(d->try_emplace(name.c_str()), &stats);
+		}
+	}
+	catch (const std::bad_alloc &)
+	{	assert(false);
+		return VI_FAILURE;
+	}
+	return static_cast<VI_TM_RESULT>(entries.size());
+}
+
+VI_TM_RESULT VI_TM_CALL vi_tmRegistryRemoveMeas(VI_TM_HREG registry, VI_TM_HMEAS meas)
+{	if (!verify(!!meas))
+	{	return VI_FAILURE;
+	}
+	return misc::from_handle(registry)->remove(meas);
+}
+
+VI_TM_RESULT VI_TM_CALL vi_tmRegistryEvictIdle(VI_TM_HREG registry, unsigned cycles)
+{	return misc::from_handle(registry)->evict_idle(cycles);
+}
+
+VI_TM_RESULT VI_TM_CALL vi_tmRegistryReclaim(VI_TM_HREG registry)
+{	return misc::from_handle(registry)->reclaim();
+}
+
+VI_TM_RESULT VI_TM_CALL vi_tmRegistryMirror(VI_TM_HREG registry, const char *name, VI_TM_SIZE capacity)
+{	return misc::from_handle(registry)->mirror(name, capacity);
+}
+
 VI_TM_HMEAS VI_TM_CALL vi_tmRegistryGetMeas(VI_TM_HREG registry, const char *name)
-{	return static_cast<VI_TM_HMEAS>(&misc::from_handle(registry)->try_emplace(name));
+{	return misc::from_handle(registry)->try_emplace(name);
+}
+
+namespace
+{	inline cell_t* cell_of(VI_TM_HMEAS meas, generation_t &gen) noexcept
+	{	return verify(meas) ? cells.at(meas, gen) : nullptr;
+	}
 }
 
 void VI_TM_CALL vi_tmMeasurementAdd(VI_TM_HMEAS meas, VI_TM_TDIFF tick_diff, VI_TM_SIZE cnt) noexcept
-{	if (verify(meas)) { meas->second.add(tick_diff, cnt); }
+{	generation_t gen = 0U;
+	if (const auto cell = cell_of(meas, gen)) { cell->meter_.add(gen, tick_diff, cnt); }
+}
+
+void VI_TM_CALL vi_tmMeasurementAddCpu(VI_TM_HMEAS meas, VI_TM_TDIFF tick_diff, VI_TM_TDIFF cpu, VI_TM_SIZE cnt) noexcept
+{	vi_tmCounters_t ctr{};
+	ctr.cpu_ = cpu;
+	vi_tmMeasurementAddEx(meas, tick_diff, &ctr, cnt);
+}
+
+void VI_TM_CALL vi_tmMeasurementAddEx(VI_TM_HMEAS meas, VI_TM_TDIFF tick_diff, const vi_tmCounters_t *ctr, VI_TM_SIZE cnt) noexcept
+{	generation_t gen = 0U;
+	if (const auto cell = cell_of(meas, gen))
+	{	if (ctr) { cell->meter_.add(gen, tick_diff, *ctr, cnt); }
+		else { cell->meter_.add(gen, tick_diff, cnt); }
+	}
+}
+
+VI_TM_SPAN VI_TM_CALL vi_tmSpanBegin(void) noexcept
+{	return vi_tmGetTicks();
+}
+
+void VI_TM_CALL vi_tmSpanEnd(VI_TM_HMEAS meas, VI_TM_SPAN token, VI_TM_SIZE cnt) noexcept
+{	const auto finish = vi_tmGetTicks();
+	auto dur = finish - token;
+	if (static_cast<std::int64_t>(dur) < 0)
+	{	dur = 0U; // The span ended before it began: the clocks of the processors differ, or the token is invalid. A wrapped value would ruin the statistics.
+	}
+	generation_t gen = 0U;
+	if (const auto cell = cell_of(meas, gen)) { cell->meter_.add(gen, dur, cnt); }
+}
+
+namespace
+{	// The counter of a thread holds the id of the thread in the high half and the number of its probes in the low half; the count
+	// wraps within NESTED_COUNT and the top bit of the low half stays zero. So the difference of two values read on the same thread
+	// is at most NESTED_COUNT, while the difference of values with distinct ids (an interval that began on one thread and ended on
+	// another, e.g. a probe of a coroutine resumed elsewhere) always exceeds it, borrow or not, and is not compensated.
+	// The ids are assigned in turn and repeat only after 2^32 threads (2^16 with a 32-bit VI_TM_SIZE).
+	constexpr auto NESTED_ID_SHIFT = sizeof(VI_TM_SIZE) * CHAR_BIT / 2U;
+	constexpr auto NESTED_COUNT = (VI_TM_SIZE{ 1 } << (NESTED_ID_SHIFT - 1U)) - 1U; // Mask of the number of probes.
+	std::atomic<VI_TM_SIZE> nested_threads{ 0U };
+
+	VI_TM_SIZE& nested_probes() noexcept // Probes finished on the thread via vi_tmMeasurementAddNested.
+	{	thread_local VI_TM_SIZE counter = 0U;
+		thread_local bool ready = false;
+		if (!ready)
+		{	ready = true; // Before the calibration, which itself calls vi_tmMeasurementAddNested.
+			counter = nested_threads.fetch_add(1U, std::memory_order_relaxed) << NESTED_ID_SHIFT;
+			if (!misc::properties_t::calibrating())
+			{	// The first compensated probe of the process starts here, so the calibration does not fall into any compensated interval.
+				(void)misc::properties_t::props();
+			}
+		}
+		return counter;
+	}
+}
+
+VI_TM_SIZE VI_TM_CALL vi_tmNestedProbes(void) noexcept
+{	return nested_probes();
+}
+
+void VI_TM_CALL vi_tmMeasurementAddNested(VI_TM_HMEAS meas, VI_TM_TDIFF tick_diff, VI_TM_SIZE nested, const vi_tmCounters_t *ctr, VI_TM_SIZE cnt) noexcept
+{	if (0U != nested && nested <= NESTED_COUNT) // Otherwise the interval crossed threads (or the count wrapped within it).
+	{	static const double cost = misc::properties_t::props().duration_threadsafe_;
+		const auto correction = static_cast<VI_TM_TDIFF>(cost * static_cast<double>(nested) + 0.5);
+		tick_diff = (tick_diff > correction) ? tick_diff - correction : VI_TM_TDIFF{ 0 };
+	}
+	vi_tmMeasurementAddEx(meas, tick_diff, ctr, cnt);
+	auto &counter = nested_probes();
+	counter = (counter & ~NESTED_COUNT) | ((counter + 1U) & NESTED_COUNT); // The id of the thread is kept.
 }
 
 void VI_TM_CALL vi_tmMeasurementMerge(VI_TM_HMEAS meas, const vi_tmStats_t *src) noexcept
-{	if (verify(meas)) { meas->second.merge(*src); }
+{	generation_t gen = 0U;
+	if (const auto cell = cell_of(meas, gen)) { cell->meter_.merge(gen, *src); }
 }
 
 void VI_TM_CALL vi_tmMeasurementGet(VI_TM_HMEAS meas, const char* *name, vi_tmStats_t *data)
-{	if (verify(meas))
-	{	if (name) { *name = meas->first.c_str(); }
-		if (data) { *data = meas->second.get(); }
+{	generation_t gen = 0U;
+	if (const auto cell = cell_of(meas, gen); !cell || !cell->meter_.get(gen, name, data))
+	{	// The measurement was reclaimed or its registry closed.
+		if (name) { *name = ""; }
+		if (data) { vi_tmStatsReset(data); }
 	}
 }
 
 void VI_TM_CALL vi_tmMeasurementReset(VI_TM_HMEAS meas)
-{	if (verify(meas)) { meas->second.reset(); }
+{	generation_t gen = 0U;
+	if (const auto cell = cell_of(meas, gen)) { cell->meter_.reset(gen); }
 }
 //^^^API Implementation ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
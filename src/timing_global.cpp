@@ -108,6 +108,38 @@ vi_tmRegistry_t* misc::from_handle(VI_TM_HREG h)
 	return h;
 }
 
+namespace
+{
+	// Private registry of a thread. Its measurements are folded into the parent registry when the thread exits.
+	class thread_registry_t final
+	{	VI_TM_HREG handle_ = nullptr;
+		VI_TM_HREG parent_ = nullptr;
+	public:
+		thread_registry_t() = default;
+		thread_registry_t(const thread_registry_t &) = delete;
+		thread_registry_t &operator=(const thread_registry_t &) = delete;
+		~thread_registry_t()
+		{	if (handle_)
+			{	verify(VI_SUCCEEDED(vi_tmRegistryMerge(parent_, handle_)));
+				vi_tmRegistryClose(handle_);
+			}
+		}
+		VI_TM_HREG get(VI_TM_HREG parent)
+		{	if (!handle_ && verify(!!parent))
+			{	handle_ = vi_tmRegistryCreate();
+				parent_ = parent;
+			}
+			assert(parent == parent_ && "The parent of the thread-local registry is fixed by the first call.");
+			return handle_;
+		}
+	};
+}
+
+VI_TM_HREG VI_TM_CALL vi_tmThreadLocalRegistry(VI_TM_HREG parent)
+{	thread_local thread_registry_t instance;
+	return instance.get(parent);
+}
+
 VI_TM_RESULT VI_TM_CALL vi_tmGlobalInit(VI_TM_FLAGS flags, const char *title, const char *footer)
 {	assert((flags & ~vi_tmReportFlagsMask) == 0);
 	if (auto const global = global_registry_t::instance())
@@ -7,7 +7,13 @@
 #include <array>
 #include <ctime> // for timespec_get
 #include <chrono> // for std::chrono
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <random>
+#include <string>
+#include <thread>
+#include <vector>
 
 const auto arr = []
 	{	constexpr double mean = 100e6;
@@ -186,3 +192,109 @@ static void BM_vi_tm_S(benchmark::State &state)
 	}
 }
 BENCHMARK(BM_vi_tm_S);
+
+// Without VI_TM_THREADSAFE only the cases that do not share data between threads run with more than one thread.
+namespace
+{	const int max_threads = static_cast<int>(std::max(1U, std::thread::hardware_concurrency()));
+#if VI_TM_THREADSAFE
+	const int max_shared_threads = max_threads;
+#else
+	const int max_shared_threads = 1;
+#endif
+
+	// A minimal MPMC queue: enough to compare the per-task cost of vi_tm::timed_task_t with a plain task.
+	class task_queue_t
+	{	std::mutex mtx_;
+		std::deque<std::function<void()>> tasks_;
+	public:
+		void push(std::function<void()> task)
+		{	std::lock_guard lock{ mtx_ };
+			tasks_.push_back(std::move(task));
+		}
+		std::function<void()> pop() // Each thread pushes before it pops, so the queue is never empty here.
+		{	std::lock_guard lock{ mtx_ };
+			auto result = std::move(tasks_.front());
+			tasks_.pop_front();
+			return result;
+		}
+	};
+}
+
+template<bool Timed>
+static void BM_task_queue(benchmark::State &state)
+{	static task_queue_t queue;
+	static const vi_tm::task_meas_t meas{ VI_TM_HGLOBAL, "BM_task_queue" };
+	const auto fn = [] { benchmark::ClobberMemory(); };
+	for (auto _ : state)
+	{	if constexpr (Timed)
+		{	queue.push(vi_tm::make_timed_task(meas, fn));
+		}
+		else
+		{	queue.push(fn);
+		}
+		queue.pop()();
+	}
+}
+// The timed tasks of all threads add to the same measurements; the plain ones run with the same threads for comparison.
+BENCHMARK(BM_task_queue<false>)->ThreadRange(1, std::min(8, max_shared_threads))->UseRealTime();
+BENCHMARK(BM_task_queue<true>)->ThreadRange(1, std::min(8, max_shared_threads))->UseRealTime();
+
+// Contention of the collection hot path: scaling with the number of threads (--benchmark_filter=BM_contention).
+namespace
+{	VI_TM_HREG contention_registry = nullptr; // A private registry: the created names do not pile up in the global one.
+	std::vector<VI_TM_HMEAS> contention_meas;
+	std::vector<std::string> contention_names;
+
+	void contention_setup(const benchmark::State &state)
+	{	contention_registry = vi_tmRegistryCreate();
+		contention_meas.clear();
+		contention_names.clear();
+		for (int n = 0; n < std::max(state.threads(), 64); ++n)
+		{	contention_names.push_back("name_" + std::to_string(n));
+			contention_meas.push_back(vi_tmRegistryGetMeas(contention_registry, contention_names.back().c_str()));
+		}
+	}
+
+	void contention_teardown(const benchmark::State &)
+	{	vi_tmRegistryClose(contention_registry);
+		contention_registry = nullptr;
+	}
+}
+
+static void BM_contention_add_shared(benchmark::State &state)
+{	const auto m = contention_meas.front();
+	std::size_t n = static_cast<std::size_t>(state.thread_index());
+	for (auto _ : state)
+	{	vi_tmMeasurementAdd(m, arr[n++ % arr.size()], 1);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_contention_add_shared)->Setup(contention_setup)->Teardown(contention_teardown)->ThreadRange(1, max_shared_threads)->UseRealTime();
+
+static void BM_contention_add_distinct(benchmark::State &state)
+{	const auto m = contention_meas[static_cast<std::size_t>(state.thread_index())];
+	std::size_t n = static_cast<std::size_t>(state.thread_index());
+	for (auto _ : state)
+	{	vi_tmMeasurementAdd(m, arr[n++ % arr.size()], 1);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_contention_add_distinct)->Setup(contention_setup)->Teardown(contention_teardown)->ThreadRange(1, max_threads)->UseRealTime();
+
+// Lookups of the existing names, and a new name every 16th call.
+static void BM_contention_get_meas(benchmark::State &state)
+{	const auto prefix = "new_" + std::to_string(state.thread_index()) + "_";
+	std::size_t n = 0U;
+	std::string name;
+	for (auto _ : state)
+	{	if (0U == ++n % 16U)
+		{	name = prefix + std::to_string(n);
+			benchmark::DoNotOptimize(vi_tmRegistryGetMeas(contention_registry, name.c_str()));
+		}
+		else
+		{	benchmark::DoNotOptimize(vi_tmRegistryGetMeas(contention_registry, contention_names[n % contention_names.size()].c_str()));
+		}
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_contention_get_meas)->Setup(contention_setup)->Teardown(contention_teardown)->ThreadRange(1, max_shared_threads)->UseRealTime();
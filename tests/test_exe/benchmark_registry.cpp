@@ -0,0 +1,172 @@
+#include "benchmark.h"
+
+#include <vi_timing/vi_timing.h>
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#	include <windows.h>
+#	include <psapi.h> // GetProcessMemoryInfo()
+#elif defined(__linux__)
+#	include <unistd.h> // sysconf()
+#endif
+
+// Scaling of the registry with the number of measurement names (--benchmark_filter=BM_registry).
+// The registries are filled with 10, 1k, 100k and 1M names; a quarter of them are long VI_FUNCNAME-like signatures.
+namespace
+{	std::string registry_name(std::size_t n)
+	{	const auto s = std::to_string(n);
+		switch (n % 4U)
+		{
+		case 0U: return "void app::pipeline_t<std::vector<std::basic_string<char>, std::allocator<std::basic_string<char>>>>::stage_" + s +
+			"(const std::string&, std::size_t) [with T = std::vector<std::basic_string<char>, std::allocator<std::basic_string<char>>>]";
+		case 1U: return "db.query.select_" + s;
+		case 2U: return "render/frame/pass_" + s;
+		default: return "worker_" + s;
+		}
+	}
+
+	std::size_t rss_bytes() // Resident set size of the process, or 0 if it is unknown.
+	{
+#if defined(_WIN32)
+		PROCESS_MEMORY_COUNTERS pmc{};
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+		{	return pmc.WorkingSetSize;
+		}
+#elif defined(__linux__)
+		if (auto f = std::fopen("/proc/self/statm", "r"))
+		{	unsigned long size = 0U;
+			unsigned long resident = 0U;
+			const auto read = std::fscanf(f, "%lu %lu", &size, &resident);
+			std::fclose(f);
+			if (2 == read)
+			{	return static_cast<std::size_t>(resident) * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+			}
+		}
+#endif
+		return 0U;
+	}
+
+	VI_TM_HREG registry = nullptr;
+	std::vector<std::string> registry_names;
+
+	void names_setup(const benchmark::State &state)
+	{	const auto size = static_cast<std::size_t>(state.range(0));
+		registry_names.clear();
+		registry_names.reserve(size);
+		for (std::size_t n = 0; n < size; ++n)
+		{	registry_names.push_back(registry_name(n));
+		}
+	}
+
+	void names_teardown(const benchmark::State &)
+	{	registry_names = {};
+	}
+
+	void registry_setup(const benchmark::State &state)
+	{	names_setup(state);
+		registry = vi_tmRegistryCreate();
+		for (std::size_t n = 0; n < registry_names.size(); ++n) // Measurements with data, so the report has something to format and sort.
+		{	const auto m = vi_tmRegistryGetMeas(registry, registry_names[n].c_str());
+			vi_tmMeasurementAdd(m, static_cast<VI_TM_TDIFF>(1'000U + n % 997U), 1);
+			vi_tmMeasurementAdd(m, static_cast<VI_TM_TDIFF>(1'100U + n % 991U), 1);
+		}
+	}
+
+	void registry_teardown(const benchmark::State &state)
+	{	vi_tmRegistryClose(registry);
+		registry = nullptr;
+		names_teardown(state);
+	}
+
+	double rss_delta(std::size_t before)
+	{	return static_cast<double>(rss_bytes()) - static_cast<double>(before);
+	}
+
+	void registry_sizes(benchmark::internal::Benchmark *b)
+	{	b->ArgName("names")->Arg(10)->Arg(1'000)->Arg(100'000)->Arg(1'000'000);
+	}
+}
+
+// Filling an empty registry: insertion with all the rehashes, and the resident memory per name.
+static void BM_registry_fill(benchmark::State &state)
+{	const auto size = static_cast<std::size_t>(state.range(0));
+	double rss = 0.0;
+	for (auto _ : state)
+	{	const auto before = rss_bytes();
+		const auto reg = vi_tmRegistryCreate();
+		for (const auto &name : registry_names)
+		{	benchmark::DoNotOptimize(vi_tmRegistryGetMeas(reg, name.c_str()));
+		}
+		state.PauseTiming();
+		rss += rss_delta(before);
+		vi_tmRegistryClose(reg);
+		state.ResumeTiming();
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+	state.counters["rss_per_name"] = benchmark::Counter{ rss / static_cast<double>(size), benchmark::Counter::kAvgIterations };
+}
+BENCHMARK(BM_registry_fill)->Setup(names_setup)->Teardown(names_teardown)->Apply(registry_sizes)->Unit(benchmark::kMillisecond);
+
+// Lookups of the existing names in a scattered order.
+static void BM_registry_hit(benchmark::State &state)
+{	const auto size = registry_names.size();
+	std::size_t n = 0U;
+	for (auto _ : state)
+	{	benchmark::DoNotOptimize(vi_tmRegistryGetMeas(registry, registry_names[n].c_str()));
+		n = (n + 7'919U) % size; // A prime step: consecutive lookups do not touch neighbouring names.
+	}
+}
+BENCHMARK(BM_registry_hit)->Setup(registry_setup)->Teardown(registry_teardown)->Apply(registry_sizes);
+
+// vi_tmRegistryGetMeas() inserts missing names, so a miss is measured together with the removal that keeps the size constant.
+static void BM_registry_miss(benchmark::State &state)
+{	std::size_t n = 0U;
+	std::string name = "missing";
+	// The first insertion may rehash the whole table; it must not be averaged into the few iterations of the big registries.
+	(void)vi_tmRegistryRemoveMeas(registry, vi_tmRegistryGetMeas(registry, name.c_str()));
+	for (auto _ : state)
+	{	name = "missing_" + std::to_string(n);
+		const auto m = vi_tmRegistryGetMeas(registry, name.c_str());
+		benchmark::DoNotOptimize(vi_tmRegistryRemoveMeas(registry, m));
+		if (0U == ++n % 1'024U)
+		{	state.PauseTiming();
+			vi_tmRegistryReclaim(registry);
+			state.ResumeTiming();
+		}
+	}
+	state.SetLabel("insert + remove");
+}
+BENCHMARK(BM_registry_miss)->Setup(registry_setup)->Teardown(registry_teardown)->Apply(registry_sizes);
+
+static void BM_registry_enumerate(benchmark::State &state)
+{	static constexpr vi_tmMeasEnumCb_t fn = [](VI_TM_HMEAS m, void *) -> VI_TM_RESULT
+		{	benchmark::DoNotOptimize(m);
+			return 0;
+		};
+	for (auto _ : state)
+	{	benchmark::DoNotOptimize(vi_tmRegistryEnumerateMeas(registry, fn, nullptr));
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_registry_enumerate)->Setup(registry_setup)->Teardown(registry_teardown)->Apply(registry_sizes)->Unit(benchmark::kMicrosecond);
+
+// Wall time of the whole report; the text is discarded.
+static void BM_registry_report(benchmark::State &state)
+{	static constexpr vi_tmReportCb_t cb = [](const char *str, void *) -> VI_TM_RESULT
+		{	return static_cast<VI_TM_RESULT>(std::strlen(str));
+		};
+	(void)vi_tmRegistryReport(registry, vi_tmReportDefault, cb, nullptr); // The first report also measures the clock properties.
+	const auto before = rss_bytes();
+	for (auto _ : state)
+	{	benchmark::DoNotOptimize(vi_tmRegistryReport(registry, vi_tmReportDefault, cb, nullptr));
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+	state.counters["rss_growth"] = rss_delta(before);
+}
+BENCHMARK(BM_registry_report)->Setup(registry_setup)->Teardown(registry_teardown)->Apply(registry_sizes)->Unit(benchmark::kMillisecond)->UseRealTime();
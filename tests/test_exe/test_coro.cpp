@@ -0,0 +1,63 @@
+#include "test.h"
+
+#include <vi_timing/vi_timing.hpp>
+
+#include <gtest/gtest.h>
+
+#ifdef VI_TM_HAS_COROUTINES
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <thread>
+
+namespace
+{
+	// A coroutine that starts eagerly and is resumed manually by the test.
+	struct task_t
+	{	struct promise_type
+		{	task_t get_return_object() noexcept { return {}; }
+			std::suspend_never initial_suspend() noexcept { return {}; }
+			std::suspend_never final_suspend() noexcept { return {}; }
+			void return_void() noexcept {}
+			void unhandled_exception() { std::terminate(); }
+		};
+	};
+
+	// Suspends the coroutine and stores its handle for the test to resume.
+	struct park_t
+	{	std::coroutine_handle<> &h_;
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(std::coroutine_handle<> h) noexcept { h_ = h; }
+		int await_resume() const noexcept { return 42; }
+	};
+
+	task_t worker(VI_TM_HMEAS active, VI_TM_HMEAS suspended, std::coroutine_handle<> &h, int &result)
+	{	vi_tm::coro_probe_t probe{ active, suspended };
+		result = co_await probe(park_t{ h });
+		co_await probe(std::suspend_never{}); // await_ready() is true: the probe is not switched.
+	}
+}
+
+TEST_F(ViTimingRegistryFixture, coro_probe)
+{	const auto active = vi_tmRegistryGetMeas(registry(), "active");
+	const auto suspended = vi_tmRegistryGetMeas(registry(), "suspended");
+	std::coroutine_handle<> h;
+	int result = 0;
+
+	worker(active, suspended, h, result);
+	ASSERT_TRUE(h) << "The coroutine must be suspended.";
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	std::thread{ [h] { h.resume(); } }.join(); // Resume on another thread.
+	EXPECT_EQ(result, 42);
+
+	vi_tmStats_t a{};
+	vi_tmStats_t s{};
+	vi_tmMeasurementGet(active, nullptr, &a);
+	vi_tmMeasurementGet(suspended, nullptr, &s);
+	EXPECT_EQ(a.calls_, 1U);
+	EXPECT_EQ(s.calls_, 1U);
+#if VI_TM_STAT_USE_RAW
+	EXPECT_GT(s.sum_, a.sum_) << "The sleep must be counted as suspended time only.";
+#endif
+}
+#endif // #ifdef VI_TM_HAS_COROUTINES
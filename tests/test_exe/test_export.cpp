@@ -0,0 +1,138 @@
+#include "test.h"
+
+#include <vi_timing/vi_timing.hpp>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	class ExportFixture: public ViTimingRegistryFixture
+	{
+	protected:
+		std::string export_text(vi_tmExportFormat_e format) const
+		{	std::string result;
+			const auto cb = [](const char *str, void *ctx) { *static_cast<std::string *>(ctx) += str; return 0; };
+			EXPECT_EQ(0, vi_tmRegistryExport(registry(), format, cb, &result));
+			return result;
+		}
+
+		static std::vector<std::string> lines(const std::string &text)
+		{	std::vector<std::string> result;
+			std::istringstream is{ text };
+			for (std::string line; std::getline(is, line);)
+			{	result.push_back(line);
+			}
+			return result;
+		}
+
+		void SetUp() override
+		{	ViTimingRegistryFixture::SetUp();
+			const auto m = vi_tmRegistryGetMeas(registry(), "quote\"back\\slash");
+			vi_tmMeasurementAdd(m, 1'000U, 2U);
+			vi_tmMeasurementAdd(m, 3'000U, 2U);
+			(void)vi_tmRegistryGetMeas(registry(), "empty");
+		}
+	};
+}
+
+TEST_F(ExportFixture, Json)
+{	const auto text = export_text(vi_tmExportJson);
+	const auto l = lines(text);
+	ASSERT_EQ(4U, l.size()) << text;
+	EXPECT_EQ(0U, l[0].find("{\"seconds_per_tick\":"));
+	EXPECT_NE(std::string::npos, l[0].find(",\"measurements\":["));
+	EXPECT_EQ("]}", l[3]);
+
+	const auto &row = l[1].find("quote") != std::string::npos ? l[1] : l[2];
+	EXPECT_EQ(0U, row.find(R"({"name":"quote\"back\\slash","calls":2)")) << row;
+#if VI_TM_STAT_USE_RAW
+	EXPECT_NE(std::string::npos, row.find(R"("count":4,"ticks":4000,)")) << row;
+#endif
+	const auto &empty = l[1].find("quote") != std::string::npos ? l[2] : l[1];
+	EXPECT_EQ(0U, empty.find(R"({"name":"empty","calls":0)")) << empty;
+#if VI_TM_STAT_USE_RMSE || VI_TM_STAT_USE_RAW
+	EXPECT_NE(std::string::npos, empty.find(R"("mean":null)")) << empty;
+#endif
+	EXPECT_EQ(',', l[1].back());
+	EXPECT_EQ('}', l[2].back());
+}
+
+TEST_F(ExportFixture, Csv)
+{	const auto text = export_text(vi_tmExportCsv);
+	const auto l = lines(text);
+	ASSERT_EQ(3U, l.size()) << text;
+	EXPECT_EQ(0U, l[0].find("name,calls"));
+
+	const auto &row = l[1].find("quote") != std::string::npos ? l[1] : l[2];
+	EXPECT_EQ(0U, row.find(R"("quote""back\slash",2)")) << row;
+#if VI_TM_STAT_USE_RAW
+	EXPECT_NE(std::string::npos, row.find(",4,4000,")) << row;
+#endif
+	for (const auto &s : l)
+	{	EXPECT_EQ(std::count(l[0].begin(), l[0].end(), ','), std::count(s.begin(), s.end(), ',')) << s;
+	}
+}
+
+TEST_F(ExportFixture, Prometheus)
+{	const auto text = export_text(vi_tmExportPrometheus);
+	EXPECT_EQ(0U, text.find("# HELP vi_tm_calls_total "));
+	EXPECT_NE(std::string::npos, text.find("# TYPE vi_tm_calls_total counter\n"));
+	EXPECT_NE(std::string::npos, text.find("vi_tm_calls_total{name=\"quote\\\"back\\\\slash\"} 2\n"));
+	EXPECT_NE(std::string::npos, text.find("vi_tm_calls_total{name=\"empty\"} 0\n"));
+#if VI_TM_STAT_USE_RAW
+	EXPECT_NE(std::string::npos, text.find("vi_tm_ticks_total{name=\"empty\"} 0\n"));
+	EXPECT_NE(std::string::npos, text.find("# TYPE vi_tm_seconds gauge\n")); // The overhead correction is not monotonic.
+	EXPECT_NE(std::string::npos, text.find("vi_tm_mean_seconds{name=\"empty\"} NaN\n"));
+#endif
+}
+
+#if VI_TM_STAT_USE_RMSE || VI_TM_STAT_USE_RAW
+TEST_F(ExportFixture, SnapshotDiff)
+{	const auto cb = [](const char *str, void *ctx) { *static_cast<std::string *>(ctx) += str; return 0; };
+	const auto fill = [this](VI_TM_TDIFF slow)
+		{	vi_tmRegistryReset(registry());
+			const auto stable = vi_tmRegistryGetMeas(registry(), "stable");
+			const auto changed = vi_tmRegistryGetMeas(registry(), "changed");
+			for (VI_TM_TDIFF n = 0; n < 100U; ++n)
+			{	vi_tmMeasurementAdd(stable, 10'000U + n % 10U * 100U);
+				vi_tmMeasurementAdd(changed, slow + n % 10U * 100U);
+			}
+		};
+
+	fill(10'000U);
+	const auto base = export_text(vi_tmExportCsv);
+	std::string out;
+	EXPECT_EQ(0, vi_tmSnapshotDiff(base.c_str(), base.c_str(), 0.05, cb, &out)) << out;
+
+	fill(20'000U);
+	const auto slower = export_text(vi_tmExportCsv);
+	out.clear();
+	EXPECT_EQ(1, vi_tmSnapshotDiff(base.c_str(), slower.c_str(), 0.05, cb, &out)) << out;
+	EXPECT_NE(std::string::npos, out.find("REGRESSED")) << out;
+	out.clear();
+	EXPECT_EQ(0, vi_tmSnapshotDiff(slower.c_str(), base.c_str(), 0.05, cb, &out)) << out;
+	EXPECT_NE(std::string::npos, out.find("improved")) << out;
+	out.clear();
+	EXPECT_EQ(0, vi_tmSnapshotDiff(base.c_str(), slower.c_str(), 2.0, cb, &out)) << "Below the threshold.\n" << out;
+
+	out.clear();
+	EXPECT_TRUE(VI_FAILED(vi_tmSnapshotDiff(base.c_str(), "not,a\nsnapshot\n", 0.05, cb, &out)));
+}
+#endif
+
+TEST_F(ExportFixture, SnapshotDiffBatched)
+{	// 10 calls of 1000 events each: the sample size is 10, not 10000, so a 10% change within the spread is not significant.
+	const auto cb = [](const char *str, void *ctx) { *static_cast<std::string *>(ctx) += str; return 0; };
+	const std::string base = "name,calls,filtered_calls,filtered_count,mean,stddev\n\"batched\",10,10,10000,1.0e-6,0.5e-6\n";
+	const std::string curr = "name,calls,filtered_calls,filtered_count,mean,stddev\n\"batched\",10,10,10000,1.1e-6,0.5e-6\n";
+	std::string out;
+	EXPECT_EQ(0, vi_tmSnapshotDiff(base.c_str(), curr.c_str(), 0.05, cb, &out)) << out;
+	EXPECT_EQ(std::string::npos, out.find("REGRESSED")) << out;
+
+	const std::string slower = "name,calls,filtered_calls,filtered_count,mean,stddev\n\"batched\",10,10,10000,2.0e-6,0.5e-6\n";
+	out.clear();
+	EXPECT_EQ(1, vi_tmSnapshotDiff(base.c_str(), slower.c_str(), 0.05, cb, &out)) << out;
+}
@@ -4,8 +4,14 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <cassert>
 #include <cerrno>
+#include <chrono>
+#include <climits>
+#include <memory>
+#include <string>
+#include <thread>
 
 TEST_F(ViTimingRegistryFixture, measurement)
 {   const char name[] = "test_entry";
@@ -65,8 +71,299 @@ TEST_F(ViTimingRegistryFixture, Registry)
 
 	const auto tmp = vi_tmRegistryGetMeas(registry(), name);
 	EXPECT_EQ(meas, tmp);
+
+	// The reset is applied lazily, so the first update after it starts from scratch.
+	vi_tmMeasurementAdd(meas, DUR, AMT);
+	vi_tmMeasurementGet(meas, nullptr, &stats);
+	EXPECT_EQ(stats.calls_, 1U) << "Statistics collected before the reset must not reappear";
+#if VI_TM_STAT_USE_RAW
+	EXPECT_EQ(stats.cnt_, AMT);
+	EXPECT_EQ(stats.sum_, DUR);
+#endif
+}
+
+TEST_F(ViTimingRegistryFixture, Merge)
+{	const std::unique_ptr<std::remove_pointer_t<VI_TM_HREG>, decltype(&vi_tmRegistryClose)> src{ vi_tmRegistryCreate(), vi_tmRegistryClose };
+	ASSERT_NE(src, nullptr);
+
+	const auto both_dst = vi_tmRegistryGetMeas(registry(), "both");
+	vi_tmMeasurementAdd(both_dst, 100U, 1U);
+	vi_tmMeasurementAdd(vi_tmRegistryGetMeas(src.get(), "both"), 300U, 2U);
+	vi_tmMeasurementAdd(vi_tmRegistryGetMeas(src.get(), "src_only"), 50U, 5U);
+	(void)vi_tmRegistryGetMeas(src.get(), "empty");
+
+	EXPECT_EQ(2, vi_tmRegistryMerge(registry(), src.get())) << "Measurements without calls are skipped.";
+#ifdef NDEBUG // The argument check asserts in debug builds.
+	EXPECT_GT(0, vi_tmRegistryMerge(registry(), registry()));
+#endif
+
+	vi_tmStats_t stats{};
+	vi_tmMeasurementGet(both_dst, nullptr, &stats);
+	EXPECT_EQ(stats.calls_, 2U);
+#if VI_TM_STAT_USE_RAW
+	EXPECT_EQ(stats.cnt_, 3U);
+	EXPECT_EQ(stats.sum_, 400U);
+#endif
+	vi_tmMeasurementGet(vi_tmRegistryGetMeas(registry(), "src_only"), nullptr, &stats);
+	EXPECT_EQ(stats.calls_, 1U);
+
+	vi_tmMeasurementGet(vi_tmRegistryGetMeas(src.get(), "both"), nullptr, &stats);
+	EXPECT_EQ(stats.calls_, 1U) << "The source must not change.";
+}
+
+TEST_F(ViTimingRegistryFixture, RemoveAndEvict)
+{	const auto count = [this]
+		{	int result = 0;
+			vi_tmRegistryEnumerateMeas(registry(), [](VI_TM_HMEAS, void *ctx) { ++*static_cast<int *>(ctx); return 0; }, &result);
+			return result;
+		};
+
+	const auto busy = vi_tmRegistryGetMeas(registry(), "busy");
+	const auto idle = vi_tmRegistryGetMeas(registry(), "idle");
+	const auto removed = vi_tmRegistryGetMeas(registry(), "removed");
+	vi_tmMeasurementAdd(removed, 10U, 1U);
+	ASSERT_EQ(3, count());
+
+	EXPECT_EQ(VI_SUCCESS, vi_tmRegistryRemoveMeas(registry(), removed));
+	EXPECT_GT(0, vi_tmRegistryRemoveMeas(registry(), removed)) << "Already removed.";
+	EXPECT_EQ(2, count());
+	vi_tmMeasurementAdd(removed, 10U, 1U); // The handle remains valid.
+	EXPECT_EQ(removed, vi_tmRegistryGetMeas(registry(), "removed")) << "The measurement is revived with its statistics.";
+	vi_tmStats_t stats{};
+	vi_tmMeasurementGet(removed, nullptr, &stats);
+	EXPECT_EQ(stats.calls_, 2U);
+	EXPECT_EQ(3, count());
+
+	for (int cycle = 0; cycle < 2; ++cycle)
+	{	vi_tmMeasurementAdd(busy, 10U, 1U);
+		vi_tmMeasurementAdd(removed, 10U, 1U);
+		EXPECT_EQ(0, vi_tmRegistryEvictIdle(registry(), 3U));
+	}
+	vi_tmMeasurementAdd(busy, 10U, 1U);
+	EXPECT_EQ(1, vi_tmRegistryEvictIdle(registry(), 3U)) << "Only 'idle' had no calls for three cycles.";
+	EXPECT_EQ(2, count());
+	EXPECT_GT(0, vi_tmRegistryRemoveMeas(registry(), idle)) << "Already evicted.";
+
+	EXPECT_EQ(1, vi_tmRegistryReclaim(registry()));
+	EXPECT_EQ(0, vi_tmRegistryReclaim(registry()));
+	EXPECT_EQ(2, count());
+
+	// Another thread keeps adding through a handle while its measurement is removed, reclaimed and the memory reused.
+	const auto stale = vi_tmRegistryGetMeas(registry(), "stale");
+	std::atomic<bool> done{ false };
+	std::thread adder{ [stale, &done] { while (!done.load()) { vi_tmMeasurementAdd(stale, 10U, 1U); } } };
+	std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	EXPECT_EQ(VI_SUCCESS, vi_tmRegistryRemoveMeas(registry(), stale));
+	EXPECT_EQ(1, vi_tmRegistryReclaim(registry()));
+	for (int n = 0; n < 1'000; ++n)
+	{	const auto fresh = vi_tmRegistryGetMeas(registry(), ("fresh_" + std::to_string(n)).c_str());
+		EXPECT_NE(fresh, stale);
+		vi_tmMeasurementAdd(fresh, 10U, 1U);
+		vi_tmMeasurementGet(fresh, nullptr, &stats);
+		EXPECT_EQ(stats.calls_, 1U) << "The outdated handle must not reach a reused measurement.";
+		EXPECT_EQ(VI_SUCCESS, vi_tmRegistryRemoveMeas(registry(), fresh));
+		EXPECT_EQ(1, vi_tmRegistryReclaim(registry()));
+	}
+	const char *name = nullptr;
+	vi_tmMeasurementGet(stale, &name, &stats);
+	done = true;
+	adder.join();
+	EXPECT_STREQ(name, "");
+	EXPECT_EQ(stats.calls_, 0U) << "Updates through the outdated handle are ignored.";
+	EXPECT_GT(0, vi_tmRegistryRemoveMeas(registry(), stale)) << "Outdated.";
+	vi_tmMeasurementGet(idle, nullptr, &stats);
+	EXPECT_EQ(stats.calls_, 0U);
+	EXPECT_EQ(2, count());
 }
 
+TEST_F(ViTimingRegistryFixture, timed_task)
+{	const vi_tm::task_meas_t meas{ registry(), "task" };
+	EXPECT_EQ(meas.wait_, vi_tmRegistryGetMeas(registry(), "task.wait"));
+	EXPECT_EQ(meas.run_, vi_tmRegistryGetMeas(registry(), "task.run"));
+
+	auto task = vi_tm::make_timed_task(meas, [](int v) { std::this_thread::sleep_for(std::chrono::milliseconds(5)); return v * 2; });
+	std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	int result = 0;
+	std::thread{ [&] { result = task(21); } }.join(); // Dequeued by another thread.
+	EXPECT_EQ(result, 42);
+
+	vi_tmStats_t wait{};
+	vi_tmStats_t run{};
+	vi_tmMeasurementGet(meas.wait_, nullptr, &wait);
+	vi_tmMeasurementGet(meas.run_, nullptr, &run);
+	EXPECT_EQ(wait.calls_, 1U);
+	EXPECT_EQ(run.calls_, 1U);
+#if VI_TM_STAT_USE_RAW
+	EXPECT_GT(wait.sum_, 0U);
+	EXPECT_GT(run.sum_, 0U);
+#endif
+}
+
+TEST_F(ViTimingRegistryFixture, bench)
+{	vi_tmBenchOptions_t opt{};
+	opt.batch_seconds_ = 0.000'1;
+	opt.max_batches_ = 20U;
+	opt.flags_ = vi_tmBenchNoWarmUp;
+
+	volatile unsigned sink = 0U;
+	unsigned calls = 0U;
+	const auto result = vi_tm::bench("bench", [&] { ++calls; for (unsigned n = 0; n < 100U; ++n) sink = sink + n; }, opt, registry());
+	EXPECT_GE(result.batches_, 1U);
+	EXPECT_LE(result.batches_, opt.max_batches_);
+	EXPECT_GE(result.iterations_, 1U);
+	EXPECT_GE(calls, result.batches_ * result.iterations_) << "Calibration and warm-up batches are not counted.";
+	EXPECT_GT(result.mean_, 0.0);
+	EXPECT_GE(result.rse_, 0.0);
+
+	vi_tmStats_t stats{};
+	vi_tmMeasurementGet(vi_tmRegistryGetMeas(registry(), "bench"), nullptr, &stats);
+	EXPECT_EQ(stats.calls_, result.batches_) << "Each batch is one call of the measurement.";
+#if VI_TM_STAT_USE_RAW
+	EXPECT_EQ(stats.cnt_, result.batches_ * result.iterations_);
+#endif
+}
+
+#if VI_TM_STAT_USE_RMSE
+TEST_F(ViTimingRegistryFixture, bench_ab)
+{	vi_tmBenchOptions_t opt{};
+	opt.batch_seconds_ = 0.000'1;
+	opt.max_batches_ = 50U;
+	opt.flags_ = vi_tmBenchNoWarmUp;
+
+	volatile unsigned sink = 0U;
+	const auto loop = [&sink](unsigned cnt) { for (unsigned n = 0; n < cnt; ++n) sink = sink + n; };
+	const auto result = vi_tm::bench_ab("short", [&] { loop(100U); }, "long", [&] { loop(1'000U); }, opt, registry());
+	EXPECT_EQ(result.a_.iterations_, result.b_.iterations_) << "Both variants use the same batch length.";
+	EXPECT_LT(result.speedup_, 0.5);
+	EXPECT_LE(result.speedup_lo_, result.speedup_);
+	EXPECT_GE(result.speedup_hi_, result.speedup_);
+	EXPECT_EQ(result.verdict_, -1) << "Ten times more work must be slower.";
+
+	vi_tmStats_t stats{};
+	vi_tmMeasurementGet(vi_tmRegistryGetMeas(registry(), "long"), nullptr, &stats);
+	EXPECT_EQ(stats.calls_, result.b_.batches_);
+
+	std::string str;
+	const auto cb = [](const char *s, void *ctx) { *static_cast<std::string *>(ctx) += s; return 0; };
+	EXPECT_TRUE(VI_SUCCEEDED(vi_tmBenchABReport("short", "long", &result, cb, &str)));
+	EXPECT_NE(str.find("long is slower."), std::string::npos) << str;
+}
+#endif
+
+#if VI_TM_STAT_USE_CPUTIME
+TEST_F(ViTimingRegistryFixture, cpu_time)
+{	const auto busy = vi_tmRegistryGetMeas(registry(), "busy");
+	const auto sleep = vi_tmRegistryGetMeas(registry(), "sleep");
+	{	const auto probe = vi_tm::scoped_probe_t::make_running(busy);
+		for (const auto stop = vi_tmGetThreadCpuTime() + 20'000'000U; vi_tmGetThreadCpuTime() < stop;)
+		{/**/}
+	}
+	{	const auto probe = vi_tm::scoped_probe_t::make_running(sleep);
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	}
+
+	vi_tmStats_t b{};
+	vi_tmStats_t s{};
+	vi_tmMeasurementGet(busy, nullptr, &b);
+	vi_tmMeasurementGet(sleep, nullptr, &s);
+	EXPECT_GE(b.cpu_, 20'000'000U) << "A busy loop is on-CPU time.";
+	EXPECT_LT(s.cpu_, 10'000'000U) << "A sleep is off-CPU time.";
+}
+#endif
+
+TEST_F(ViTimingRegistryFixture, nested)
+{	const auto meas = vi_tmRegistryGetMeas(registry(), "nested");
+	const auto cost = *static_cast<const double *>(vi_tmStaticInfo(vi_tmInfoDuration));
+	const auto dur = static_cast<VI_TM_TDIFF>(1'000.0 + 10.0 * cost);
+
+	const auto before = vi_tmNestedProbes();
+	vi_tmMeasurementAddNested(meas, dur, 0U, nullptr);
+	vi_tmMeasurementAddNested(meas, dur, 10U, nullptr);
+	vi_tmMeasurementAddNested(meas, 1U, 10U, nullptr); // Cannot be compensated below zero.
+	EXPECT_EQ(vi_tmNestedProbes() - before, 3U);
+
+	VI_TM_SIZE other = 0U;
+	std::thread{ [&other] { other = vi_tmNestedProbes(); } }.join();
+	vi_tmMeasurementAddNested(meas, dur, vi_tmNestedProbes() - other, nullptr); // Begun on another thread: not compensated.
+	vi_tmMeasurementAddNested(meas, dur, other - vi_tmNestedProbes(), nullptr); // Ended on another thread: not compensated.
+	constexpr auto ID_SHIFT = sizeof(VI_TM_SIZE) * CHAR_BIT / 2U;
+	EXPECT_NE(vi_tmNestedProbes() >> ID_SHIFT, other >> ID_SHIFT) << "The threads must have distinct ids.";
+	EXPECT_EQ(vi_tmNestedProbes() >> ID_SHIFT, before >> ID_SHIFT) << "Probes must not change the id of the thread.";
+
+	vi_tmStats_t s{};
+	vi_tmMeasurementGet(meas, nullptr, &s);
+	EXPECT_EQ(s.calls_, 5U);
+#if VI_TM_STAT_USE_RAW
+	EXPECT_NEAR(static_cast<double>(s.sum_), 4.0 * static_cast<double>(dur) - 10.0 * cost, 1.0);
+#endif
+}
+
+TEST(misc, vi_tmPerfRead)
+{	VI_TM_TDIFF before[VI_TM_PERF_COUNTERS];
+	if (VI_FAILED(vi_tmPerfRead(before)))
+	{	EXPECT_EQ(nullptr, vi_tmPerfCounterName(0U));
+		GTEST_SKIP() << "perf_event is unavailable on this host.";
+	}
+	ASSERT_NE(nullptr, vi_tmPerfCounterName(0U));
+	EXPECT_EQ(nullptr, vi_tmPerfCounterName(VI_TM_PERF_COUNTERS));
+
+	for (const auto stop = vi_tmGetThreadCpuTime() + 5'000'000U; vi_tmGetThreadCpuTime() < stop;)
+	{/**/}
+
+	VI_TM_TDIFF after[VI_TM_PERF_COUNTERS];
+	ASSERT_EQ(VI_SUCCESS, vi_tmPerfRead(after));
+	for (unsigned n = 0; n < VI_TM_PERF_COUNTERS; ++n)
+	{	EXPECT_GE(after[n], before[n]) << vi_tmPerfCounterName(n);
+	}
+	EXPECT_GT(after[0], before[0]) << "Instructions or task-clock must grow in a busy loop.";
+}
+
+TEST(misc, vi_tmRusageRead)
+{	VI_TM_TDIFF before[VI_TM_RUSAGE_COUNTERS];
+	if (VI_FAILED(vi_tmRusageRead(before)))
+	{	GTEST_SKIP() << "getrusage(RUSAGE_THREAD) is unavailable on this host.";
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	VI_TM_TDIFF after[VI_TM_RUSAGE_COUNTERS];
+	ASSERT_EQ(VI_SUCCESS, vi_tmRusageRead(after));
+	EXPECT_GT(after[0], before[0]) << "A sleep is a voluntary context switch.";
+}
+
+#if VI_TM_STAT_USE_RUSAGE
+TEST_F(ViTimingRegistryFixture, rusage)
+{	VI_TM_TDIFF tmp[VI_TM_RUSAGE_COUNTERS];
+	if (VI_FAILED(vi_tmRusageRead(tmp)))
+	{	GTEST_SKIP() << "getrusage(RUSAGE_THREAD) is unavailable on this host.";
+	}
+
+	const auto meas = vi_tmRegistryGetMeas(registry(), "sleep");
+	{	const auto probe = vi_tm::scoped_probe_t::make_running(meas);
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	vi_tmStats_t stats{};
+	vi_tmMeasurementGet(meas, nullptr, &stats);
+	EXPECT_GE(stats.rusage_[0], 1U) << "A sleep is a voluntary context switch.";
+}
+#endif
+
+#if VI_TM_STAT_USE_PERF
+TEST_F(ViTimingRegistryFixture, perf)
+{	VI_TM_TDIFF tmp[VI_TM_PERF_COUNTERS];
+	if (VI_FAILED(vi_tmPerfRead(tmp)))
+	{	GTEST_SKIP() << "perf_event is unavailable on this host.";
+	}
+
+	const auto meas = vi_tmRegistryGetMeas(registry(), "busy");
+	{	const auto probe = vi_tm::scoped_probe_t::make_running(meas);
+		for (const auto stop = vi_tmGetThreadCpuTime() + 5'000'000U; vi_tmGetThreadCpuTime() < stop;)
+		{/**/}
+	}
+	vi_tmStats_t stats{};
+	vi_tmMeasurementGet(meas, nullptr, &stats);
+	EXPECT_GT(stats.perf_[0], 0U) << vi_tmPerfCounterName(0U);
+}
+#endif
+
 TEST(misc, vi_tmStaticInfo)
 {
     const auto flags = *static_cast<const unsigned*>(vi_tmStaticInfo(vi_tmInfoFlags));
@@ -133,4 +430,40 @@ TEST(misc, vi_tmStaticInfo)
 #endif
         EXPECT_EQ(flag, flags & vi_tmStatUseMinMax) << "The use minmax flag does not match.";
     }
+
+    {
+#if VI_TM_STAT_USE_CPUTIME
+        constexpr auto flag = vi_tmStatUseCpuTime;
+#else
+		constexpr auto flag = 0U;
+#endif
+        EXPECT_EQ(flag, flags & vi_tmStatUseCpuTime) << "The use CPU time flag does not match.";
+    }
+
+    {
+#if VI_TM_STAT_USE_PERF
+        constexpr auto flag = vi_tmStatUsePerf;
+#else
+		constexpr auto flag = 0U;
+#endif
+        EXPECT_EQ(flag, flags & vi_tmStatUsePerf) << "The use perf flag does not match.";
+    }
+
+    {
+#if VI_TM_STAT_USE_RUSAGE
+        constexpr auto flag = vi_tmStatUseRusage;
+#else
+		constexpr auto flag = 0U;
+#endif
+        EXPECT_EQ(flag, flags & vi_tmStatUseRusage) << "The use rusage flag does not match.";
+    }
+
+    {
+#if VI_TM_PROBE_NESTED
+        constexpr auto flag = vi_tmProbeNested;
+#else
+		constexpr auto flag = 0U;
+#endif
+        EXPECT_EQ(flag, flags & vi_tmProbeNested) << "The probe nested flag does not match.";
+    }
 }
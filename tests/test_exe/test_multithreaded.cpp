@@ -4,6 +4,7 @@
 
 #include <cassert>
 #include <chrono>
+#include <memory>
 #include <mutex>
 #include <random>
 #include <thread>
@@ -109,3 +110,80 @@ TEST(Multithreaded, vi_tmMeasurementAdd)
 #endif
 	}
 }
+
+TEST(Multithreaded, vi_tmThreadLocalRegistry)
+{	const std::unique_ptr<std::remove_pointer_t<VI_TM_HREG>, decltype(&vi_tmRegistryClose)> parent{ vi_tmRegistryCreate(), vi_tmRegistryClose };
+	ASSERT_NE(parent, nullptr);
+
+	std::vector<std::thread> threads(numThreads);
+	for (auto &t : threads)
+	{	t = std::thread
+		{	[p = parent.get()]
+			{	const auto reg = vi_tmThreadLocalRegistry(p);
+				ASSERT_NE(reg, nullptr);
+				EXPECT_NE(reg, p);
+				EXPECT_EQ(reg, vi_tmThreadLocalRegistry(p));
+				const auto meas = vi_tmRegistryGetMeas(reg, THREADFUNCLOOP_NAME);
+				for (auto i = 0U; i < LOOP_COUNT; ++i)
+				{	vi_tmMeasurementAdd(meas, DUR, CNT);
+				}
+
+				vi_tmStats_t stats;
+				vi_tmMeasurementGet(vi_tmRegistryGetMeas(p, THREADFUNCLOOP_NAME), nullptr, &stats);
+				EXPECT_EQ(stats.calls_ % LOOP_COUNT, 0U) << "Only whole thread lifetimes are merged.";
+			}
+		};
+	}
+	for (auto &t : threads) t.join();
+
+	vi_tmStats_t stats;
+	vi_tmMeasurementGet(vi_tmRegistryGetMeas(parent.get(), THREADFUNCLOOP_NAME), nullptr, &stats);
+	ASSERT_EQ(vi_tmStatsIsValid(&stats), 0);
+	EXPECT_EQ(stats.calls_, LOOP_COUNT * numThreads);
+#if VI_TM_STAT_USE_RAW
+	EXPECT_EQ(stats.cnt_, stats.calls_ * CNT);
+	EXPECT_EQ(stats.sum_, stats.calls_ * DUR);
+#endif
+}
+
+TEST(Multithreaded, vi_tmSpan)
+{	const std::unique_ptr<std::remove_pointer_t<VI_TM_HREG>, decltype(&vi_tmRegistryClose)> registry{ vi_tmRegistryCreate(), vi_tmRegistryClose };
+	ASSERT_NE(registry, nullptr);
+	const auto meas = vi_tmRegistryGetMeas(registry.get(), "span");
+
+	// Each span begins in the producer and ends in one of the consumer threads.
+	std::vector<VI_TM_SPAN> tokens(numThreads);
+#if VI_TM_STAT_USE_RAW
+	const auto start = vi_tmGetTicks();
+#endif
+	for (auto &token : tokens)
+	{	token = vi_tmSpanBegin();
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+	std::vector<std::thread> threads;
+	for (auto token : tokens)
+	{	threads.emplace_back([meas, token] { vi_tmSpanEnd(meas, token, CNT); });
+	}
+	for (auto &t : threads) t.join();
+#if VI_TM_STAT_USE_RAW
+	const auto finish = vi_tmGetTicks();
+#endif
+
+	vi_tmStats_t stats;
+	vi_tmMeasurementGet(meas, nullptr, &stats);
+	ASSERT_EQ(vi_tmStatsIsValid(&stats), 0);
+	EXPECT_EQ(stats.calls_, numThreads);
+#if VI_TM_STAT_USE_RAW
+	EXPECT_EQ(stats.cnt_, numThreads * CNT);
+	EXPECT_LE(stats.sum_, (finish - start) * numThreads);
+	EXPECT_GT(stats.sum_, 0U);
+
+	// A token from the future (a clock ahead on the beginning processor) must not wrap around.
+	const auto sum = stats.sum_;
+	vi_tmSpanEnd(meas, vi_tmGetTicks() + 1'000'000'000U, CNT);
+	vi_tmMeasurementGet(meas, nullptr, &stats);
+	EXPECT_EQ(stats.calls_, numThreads + 1U);
+	EXPECT_EQ(stats.sum_, sum);
+#endif
+}
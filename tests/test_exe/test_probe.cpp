@@ -31,6 +31,7 @@
 //   test definitions override the production symbols.
 
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <atomic>
 #include <limits>
 #include <utility>
@@ -38,6 +39,12 @@
 #define scoped_probe_t probe_fake_t
 #define vi_tmGetTicks vi_tmGetTicks_fake
 #define vi_tmMeasurementAdd vi_tmMeasurementAdd_fake
+#define vi_tmGetThreadCpuTime vi_tmGetThreadCpuTime_fake
+#define vi_tmPerfRead vi_tmPerfRead_fake
+#define vi_tmRusageRead vi_tmRusageRead_fake
+#define vi_tmMeasurementAddEx vi_tmMeasurementAddEx_fake
+#define vi_tmNestedProbes vi_tmNestedProbes_fake
+#define vi_tmMeasurementAddNested vi_tmMeasurementAddNested_fake
 #include <vi_timing/vi_timing.hpp>
 
 // ---------------------------------------------------------------------------
@@ -63,12 +70,15 @@ namespace
 	VI_TM_HMEAS g_last_meas = UNDEF_MEAS;
 	VI_TM_TDIFF g_last_dur{ UNDEF_DIFF };
 	VI_TM_SIZE g_last_cnt{ UNDEF_SIZE };
+	VI_TM_SIZE g_last_nested{ UNDEF_SIZE };
+	VI_TM_SIZE g_nested_probes{ 0U };
 
 	// Clear recorded measurement state between tests.
 	void clear_last_measurement() noexcept
 	{	g_last_meas = UNDEF_MEAS;
 		g_last_dur = UNDEF_DIFF;
 		g_last_cnt = UNDEF_SIZE;
+		g_last_nested = UNDEF_SIZE;
 	}
 
 	// ---------------------------------------------------------------------------
@@ -102,6 +112,43 @@ void VI_TM_CALL vi_tmMeasurementAdd_fake(VI_TM_HMEAS m, VI_TM_TDIFF dur, VI_TM_S
 	g_last_cnt = cnt;
 }
 
+// With VI_TM_STAT_USE_CPUTIME, _PERF or _RUSAGE the probe reports through vi_tmMeasurementAddEx;
+// the thread counters are not checked here.
+#pragma warning(suppress: 4273)
+VI_TM_TICK VI_TM_CALL vi_tmGetThreadCpuTime_fake(void) VI_NOEXCEPT
+{	return VI_TM_TICK{ 0 };
+}
+
+#pragma warning(suppress: 4273)
+VI_TM_RESULT VI_TM_CALL vi_tmPerfRead_fake(VI_TM_TDIFF *dst) VI_NOEXCEPT
+{	std::fill_n(dst, VI_TM_PERF_COUNTERS, VI_TM_TDIFF{ 0 });
+	return VI_SUCCESS;
+}
+
+#pragma warning(suppress: 4273)
+VI_TM_RESULT VI_TM_CALL vi_tmRusageRead_fake(VI_TM_TDIFF *dst) VI_NOEXCEPT
+{	std::fill_n(dst, VI_TM_RUSAGE_COUNTERS, VI_TM_TDIFF{ 0 });
+	return VI_SUCCESS;
+}
+
+#pragma warning(suppress: 4273)
+void VI_TM_CALL vi_tmMeasurementAddEx_fake(VI_TM_HMEAS m, VI_TM_TDIFF dur, const vi_tmCounters_t *, VI_TM_SIZE cnt) VI_NOEXCEPT
+{	vi_tmMeasurementAdd_fake(m, dur, cnt);
+}
+
+// With VI_TM_PROBE_NESTED the probe reports through vi_tmMeasurementAddNested; the fake records the duration as is.
+#pragma warning(suppress: 4273)
+VI_TM_SIZE VI_TM_CALL vi_tmNestedProbes_fake(void) VI_NOEXCEPT
+{	return g_nested_probes;
+}
+
+#pragma warning(suppress: 4273)
+void VI_TM_CALL vi_tmMeasurementAddNested_fake(VI_TM_HMEAS m, VI_TM_TDIFF dur, VI_TM_SIZE nested, const vi_tmCounters_t *, VI_TM_SIZE cnt) VI_NOEXCEPT
+{	vi_tmMeasurementAdd_fake(m, dur, cnt);
+	g_last_nested = nested;
+	++g_nested_probes;
+}
+
 // ---------------------------------------------------------------------------
 // Tests
 // ---------------------------------------------------------------------------
@@ -317,3 +364,24 @@ TEST_F(ProbeTest, scoped_resume_t) {
 	advance_ticks(1);
 	EXPECT_EQ(probe.elapsed(), 5);
 }
+
+#if VI_TM_PROBE_NESTED
+TEST_F(ProbeTest, NestedProbesAreCounted) {
+	auto parent = vi_tm::scoped_probe_t::make_running(TEST_MEAS);
+	{	auto child = vi_tm::scoped_probe_t::make_running(TEST_MEAS);
+		{	auto grandchild = vi_tm::scoped_probe_t::make_running(TEST_MEAS);
+		}
+		EXPECT_EQ(g_last_nested, VI_TM_SIZE{ 0 });
+	}
+	EXPECT_EQ(g_last_nested, VI_TM_SIZE{ 1 });
+
+	parent.pause();
+	{	auto skipped = vi_tm::scoped_probe_t::make_running(TEST_MEAS); // Outside of the parent's timed region.
+	}
+	parent.resume();
+	{	auto child = vi_tm::scoped_probe_t::make_running(TEST_MEAS);
+	}
+	parent.stop();
+	EXPECT_EQ(g_last_nested, VI_TM_SIZE{ 3 }) << "The child, its grandchild and the child after resume.";
+}
+#endif
@@ -0,0 +1,109 @@
+#include "test.h"
+
+#include <vi_timing/vi_timing.hpp>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	class ReportFixture: public ViTimingRegistryFixture
+	{
+	protected:
+		// Returns the report rows: the header and the footer are hidden, the '#' and ':' columns are stripped off.
+		std::vector<std::string> rows(VI_TM_FLAGS flags, VI_TM_SIZE top = 0U, const char *filter = nullptr) const
+		{	std::string text;
+			const auto cb = [](const char *str, void *ctx) { *static_cast<std::string *>(ctx) += str; return 0; };
+			vi_tmRegistryReportEx(registry(), flags | vi_tmHideHeader, top, filter, cb, &text);
+
+			std::vector<std::string> result;
+			std::istringstream is{ text };
+			for (std::string line; std::getline(is, line);)
+			{	const auto b = line.find(". ") + 2U;
+				result.push_back(line.substr(b, line.find_first_of(" :", b) - b));
+			}
+			return result;
+		}
+
+		void add(const char *name, VI_TM_SIZE calls)
+		{	const auto m = vi_tmRegistryGetMeas(registry(), name);
+			for (VI_TM_SIZE n = 0; n < calls; ++n)
+			{	vi_tmMeasurementAdd(m, 1'000'000U);
+			}
+		}
+	};
+}
+
+TEST_F(ReportFixture, Top)
+{	const char *const names[] = { "f", "b", "h", "d", "a", "g", "c", "e" };
+	for (auto &name : names)
+	{	add(name, 1U + (*name - 'a'));
+	}
+
+	EXPECT_EQ((std::vector<std::string>{ "h", "g", "f" }), rows(vi_tmSortByAmount, 3U));
+	EXPECT_EQ((std::vector<std::string>{ "a", "b" }), rows(vi_tmSortByName | vi_tmSortAscending, 2U));
+	EXPECT_EQ(std::size(names), rows(vi_tmSortByName, 100U).size());
+	EXPECT_EQ(std::size(names), rows(vi_tmSortByName, 0U).size()) << "Zero means no limit.";
+}
+
+TEST_F(ReportFixture, Filter)
+{	for (auto name : { "db.read", "db.write", "dbx", "net.read", "net.recv" })
+	{	add(name, 1U);
+	}
+
+	const auto flags = vi_tmSortByName | vi_tmSortAscending;
+	EXPECT_EQ((std::vector<std::string>{ "db.read", "db.write" }), rows(flags, 0U, "db.*"));
+	EXPECT_EQ((std::vector<std::string>{ "db.read", "net.read" }), rows(flags, 0U, "*.read"));
+	EXPECT_EQ((std::vector<std::string>{ "net.read", "net.recv" }), rows(flags, 0U, "net.re??"));
+	EXPECT_EQ((std::vector<std::string>{ "dbx" }), rows(flags, 0U, "dbx"));
+	EXPECT_EQ((std::vector<std::string>{ "db.read" }), rows(flags, 1U, "*.*"));
+	EXPECT_TRUE(rows(flags, 0U, "xyz*").empty());
+	EXPECT_EQ(5U, rows(flags, 0U, "").size());
+	EXPECT_EQ(5U, rows(flags, 0U, "*").size());
+}
+
+#if VI_TM_STAT_USE_MINMAX
+TEST_F(ReportFixture, SortByMinMax)
+{	const auto add_ticks = [this](const char *name, std::initializer_list<VI_TM_TDIFF> ticks)
+		{	const auto m = vi_tmRegistryGetMeas(registry(), name);
+			for (auto t : ticks)
+			{	vi_tmMeasurementAdd(m, t);
+			}
+		};
+	add_ticks("narrow", { 3'000'000U, 3'000'000U, 3'000'000U });
+	add_ticks("low", { 1'000'000U, 4'000'000U, 4'000'000U });
+	add_ticks("high", { 2'000'000U, 2'000'000U, 90'000'000U });
+
+	EXPECT_EQ((std::vector<std::string>{ "low", "high", "narrow" }), rows(vi_tmSortByMin | vi_tmSortAscending));
+	EXPECT_EQ((std::vector<std::string>{ "high", "low", "narrow" }), rows(vi_tmSortByMax));
+}
+#endif
+
+#if VI_TM_STAT_USE_RMSE
+TEST_F(ReportFixture, SortByCV)
+{	const auto add_ticks = [this](const char *name, std::initializer_list<VI_TM_TDIFF> ticks)
+		{	const auto m = vi_tmRegistryGetMeas(registry(), name);
+			for (auto t : ticks)
+			{	vi_tmMeasurementAdd(m, t);
+			}
+		};
+	add_ticks("stable", { 10'000'000U, 10'000'000U, 10'000'000U, 10'000'000U });
+	add_ticks("jitter", { 10'000'000U, 12'000'000U, 8'000'000U, 10'000'000U });
+	add_ticks("single", { 10'000'000U }); // The CV is not available.
+
+	EXPECT_EQ((std::vector<std::string>{ "jitter", "stable", "single" }), rows(vi_tmSortByCV));
+	EXPECT_EQ((std::vector<std::string>{ "single", "stable", "jitter" }), rows(vi_tmSortByCV | vi_tmSortAscending));
+}
+#endif
+
+TEST_F(ReportFixture, SortKeys)
+{	// Values that are displayed identically compare equal, so the next key (here - the name) decides.
+	const auto m1 = vi_tmRegistryGetMeas(registry(), "b");
+	const auto m2 = vi_tmRegistryGetMeas(registry(), "a");
+	vi_tmMeasurementAdd(m1, 100'000'001U, 10U);
+	vi_tmMeasurementAdd(m2, 100'000'000U, 10U);
+	EXPECT_EQ((std::vector<std::string>{ "a", "b" }), rows(vi_tmSortByTime | vi_tmSortAscending));
+	EXPECT_EQ((std::vector<std::string>{ "b", "a" }), rows(vi_tmSortByTime));
+}
@@ -0,0 +1,161 @@
+#include "test.h"
+
+#include <vi_timing/vi_timing_shm.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	class ShmFixture: public ViTimingRegistryFixture
+	{	void *addr_ = MAP_FAILED;
+		std::size_t size_ = 0U;
+	protected:
+		const std::string name_ = "vi_tm_test_" + std::to_string(getpid());
+
+		void TearDown() override
+		{	if (MAP_FAILED != addr_)
+			{	munmap(addr_, size_);
+			}
+		}
+
+		const vi_tmShmHeader_t *map()
+		{	const auto fd = shm_open(("/" + name_).c_str(), O_RDONLY, 0);
+			if (fd < 0)
+			{	return nullptr;
+			}
+			struct stat st{};
+			if (0 == fstat(fd, &st))
+			{	size_ = static_cast<std::size_t>(st.st_size);
+				addr_ = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+			}
+			close(fd);
+			return MAP_FAILED == addr_ ? nullptr : static_cast<const vi_tmShmHeader_t *>(addr_);
+		}
+
+		static const vi_tmShmSlot_t *slots(const vi_tmShmHeader_t *h) { return reinterpret_cast<const vi_tmShmSlot_t *>(h + 1); }
+	};
+}
+
+TEST_F(ShmFixture, Mirror)
+{	const auto before = vi_tmRegistryGetMeas(registry(), "before");
+	vi_tmMeasurementAdd(before, 100U, 2U);
+	ASSERT_EQ(VI_SUCCESS, vi_tmRegistryMirror(registry(), name_.c_str(), 4U));
+	const auto after = vi_tmRegistryGetMeas(registry(), "after");
+	vi_tmMeasurementAdd(after, 30U);
+
+	const auto h = map();
+	ASSERT_NE(nullptr, h);
+	EXPECT_EQ(VI_TM_SHM_MAGIC, h->magic_);
+	EXPECT_EQ(VI_TM_SHM_VERSION, h->version_);
+	EXPECT_EQ(sizeof(vi_tmShmSlot_t), h->slot_size_);
+	EXPECT_EQ(4U, h->capacity_);
+	ASSERT_EQ(2U, h->count_);
+	EXPECT_EQ(static_cast<std::uint32_t>(getpid()), h->pid_);
+
+	for (auto n = 0U; n < h->count_; ++n)
+	{	const auto &slot = slots(h)[n];
+		vi_tmStats_t expected;
+		vi_tmMeasurementGet(vi_tmRegistryGetMeas(registry(), slot.name_), nullptr, &expected);
+		vi_tmStats_t actual;
+		EXPECT_LE(0, vi_tmShmSlotLoad(&slot, &actual));
+		EXPECT_EQ(0, vi_tmStatsIsValid(&actual));
+		EXPECT_EQ(expected.calls_, actual.calls_) << slot.name_;
+#if VI_TM_STAT_USE_RAW
+		EXPECT_EQ(expected.sum_, actual.sum_) << slot.name_;
+		EXPECT_EQ(expected.cnt_, actual.cnt_) << slot.name_;
+#endif
+	}
+
+	vi_tmMeasurementReset(before);
+	vi_tmStats_t actual;
+	const auto &slot = slots(h)[0] .name_ == std::string{ "before" } ? slots(h)[0] : slots(h)[1];
+	EXPECT_LE(0, vi_tmShmSlotLoad(&slot, &actual));
+	EXPECT_EQ(0U, actual.calls_);
+
+	ASSERT_EQ(VI_SUCCESS, vi_tmRegistryMirror(registry(), nullptr));
+	EXPECT_LT(shm_open(("/" + name_).c_str(), O_RDONLY, 0), 0) << "The page must be removed when mirroring stops.";
+	errno = 0; // Reset errno after the expected failure.
+}
+
+TEST_F(ShmFixture, Capacity)
+{	ASSERT_EQ(VI_SUCCESS, vi_tmRegistryMirror(registry(), name_.c_str(), 2U));
+	for (auto n : { "a", "b", "c" })
+	{	vi_tmMeasurementAdd(vi_tmRegistryGetMeas(registry(), n), 1U);
+	}
+	const auto h = map();
+	ASSERT_NE(nullptr, h);
+	EXPECT_EQ(2U, h->count_) << "Measurements beyond the capacity are not mirrored.";
+}
+
+TEST_F(ShmFixture, LockedSlot)
+{	vi_tmShmSlot_t slot{};
+	slot.seq_ = 1U; // The writer died in the middle of an update.
+	vi_tmStats_t s;
+	EXPECT_GT(0, vi_tmShmSlotLoad(&slot, &s)) << "The reader must give up instead of spinning forever.";
+}
+
+TEST_F(ShmFixture, LivePageIsKept)
+{	ASSERT_EQ(VI_SUCCESS, vi_tmRegistryMirror(registry(), name_.c_str(), 2U));
+	vi_tmMeasurementAdd(vi_tmRegistryGetMeas(registry(), "a"), 1U);
+
+	const std::unique_ptr<std::remove_pointer_t<VI_TM_HREG>, decltype(&vi_tmRegistryClose)> other{ vi_tmRegistryCreate(), vi_tmRegistryClose };
+	EXPECT_GT(0, vi_tmRegistryMirror(other.get(), name_.c_str(), 2U)) << "The page of a live writer must not be taken over.";
+
+	const auto h = map();
+	ASSERT_NE(nullptr, h);
+	EXPECT_EQ(VI_TM_SHM_MAGIC, h->magic_);
+	EXPECT_EQ(1U, h->count_);
+	EXPECT_STREQ("a", slots(h)[0].name_);
+}
+
+TEST_F(ShmFixture, StalePageIsReplaced)
+{	{	// A page left by a process that no longer exists (pid_max is far below INT32_MAX).
+		const auto fd = shm_open(("/" + name_).c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+		ASSERT_LE(0, fd);
+		vi_tmShmHeader_t header{};
+		header.magic_ = VI_TM_SHM_MAGIC;
+		header.pid_ = INT32_MAX;
+		EXPECT_EQ(static_cast<ssize_t>(sizeof(header)), write(fd, &header, sizeof(header)));
+		close(fd);
+	}
+
+	ASSERT_EQ(VI_SUCCESS, vi_tmRegistryMirror(registry(), name_.c_str(), 2U));
+	const auto h = map();
+	ASSERT_NE(nullptr, h);
+	EXPECT_EQ(static_cast<std::uint32_t>(getpid()), h->pid_);
+	EXPECT_EQ(2U, h->capacity_);
+}
+
+#if VI_TM_THREADSAFE
+TEST_F(ShmFixture, TornReads)
+{	constexpr auto DUR = 7U;
+	ASSERT_EQ(VI_SUCCESS, vi_tmRegistryMirror(registry(), name_.c_str(), 1U));
+	const auto meas = vi_tmRegistryGetMeas(registry(), "meas");
+	const auto h = map();
+	ASSERT_NE(nullptr, h);
+
+	std::atomic_bool done = false;
+	std::thread writer{ [meas, &done] { while (!done) vi_tmMeasurementAdd(meas, DUR); } };
+	for (auto n = 0U; n < 10'000U; ++n)
+	{	vi_tmStats_t s;
+		ASSERT_LE(0, vi_tmShmSlotLoad(slots(h), &s));
+#if VI_TM_STAT_USE_RAW
+		ASSERT_EQ(s.sum_, s.calls_ * DUR); // A torn read would break the relation between the fields.
+#endif
+	}
+	done = true;
+	writer.join();
+}
+#endif
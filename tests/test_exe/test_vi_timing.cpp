@@ -12,6 +12,7 @@
 #include <algorithm>
 #include <chrono>
 #include <ctime>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <ostream>
@@ -28,6 +29,10 @@ namespace
 		result += (flg & vi_tmStatUseRMSE)? "VI_TM_STAT_USE_RMSE, ": "";
 		result += (flg & vi_tmStatUseFilter)? "VI_TM_STAT_USE_FILTER, ": "";
 		result += (flg & vi_tmStatUseMinMax)? "VI_TM_STAT_USE_MINMAX, ": "";
+		result += (flg & vi_tmStatUseCpuTime)? "VI_TM_STAT_USE_CPUTIME, ": "";
+		result += (flg & vi_tmStatUsePerf)? "VI_TM_STAT_USE_PERF, ": "";
+		result += (flg & vi_tmStatUseRusage)? "VI_TM_STAT_USE_RUSAGE, ": "";
+		result += (flg & vi_tmProbeNested)? "VI_TM_PROBE_NESTED, ": "";
 		result += (flg & vi_tmThreadsafe)? "VI_TM_THREADSAFE, ": "";
 		result += (flg & vi_tmShared)? "VI_TM_SHARED, ": "";
 		result += (flg & vi_tmDebug)? "VI_TM_DEBUG, ": "";
@@ -113,6 +118,30 @@ namespace
 			}
 		);
 	}
+
+	// '--vi_tm_snapshot=<file>': saves the global registry as a CSV snapshot for the regression gate (see vi_tm_diff).
+	bool save_snapshot(int argc, char **argv)
+	{	static constexpr auto sample = "--vi_tm_snapshot="sv;
+		const auto arg = std::find_if(
+			argv,
+			argv + argc,
+			[](const char *a)
+			{	return std::string_view{ a }.substr(0, sample.size()) == sample;
+			}
+		);
+		if (argv + argc == arg)
+		{	return true;
+		}
+
+		std::ofstream file{ *arg + sample.size() };
+		const auto ret = vi_tmRegistryExport(
+			VI_TM_HGLOBAL,
+			vi_tmExportCsv,
+			[](const char *str, void *ctx) { *static_cast<std::ostream *>(ctx) << str; return 0; },
+			&file
+		);
+		return VI_SUCCEEDED(ret) && !!file;
+	}
 }
 
 int main(int argc, char** argv)
@@ -132,7 +161,16 @@ int main(int argc, char** argv)
 
 #if VI_HAS_GTEST
 	::testing::InitGoogleTest(&argc, argv);
-	if (const auto ret = RUN_ALL_TESTS(); gtest_arg || !!ret )
+	const auto ret = RUN_ALL_TESTS();
+#endif
+
+	if (!save_snapshot(argc, argv))
+	{	std::cerr << "Failed to save the snapshot.\n";
+		return 1;
+	}
+
+#if VI_HAS_GTEST
+	if (gtest_arg || !!ret )
 	{	return ret;
 	}
 #endif
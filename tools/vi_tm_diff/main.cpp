@@ -0,0 +1,94 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+/*****************************************************************************\
+* This file is part of the vi_timing library.
+*
+* vi_timing - a compact, lightweight C/C++ library for measuring code
+* execution time. It was developed for experimental and educational purposes,
+* so please keep expectations reasonable.
+*
+* Report bugs or suggest improvements to author: <programmer.amateur@proton.me>
+*
+* LICENSE & DISCLAIMER:
+* - No warranties. Use at your own risk.
+* - Licensed under Business Source License 1.1 (BSL-1.1):
+*   - Free for non-commercial use.
+*   - For commercial licensing, contact the author.
+*   - Change Date: 2029-09-01 - after which the library will be licensed
+*     under GNU GPLv3.
+*   - Attribution required: "vi_timing Library (c) A.Prograamar".
+*   - See LICENSE in the project root for full terms.
+\*****************************************************************************/
+
+// vi_tm_diff - compares two snapshots of a registry and fails if any measurement regressed (see vi_tmSnapshotDiff).
+// Usage: vi_tm_diff <baseline.csv> <current.csv> [-t <threshold>]
+// The snapshots are CSV exports: vi_tmRegistryExport(hreg, vi_tmExportCsv, ...).
+// Exit code: 0 - no regressions, 1 - some measurements regressed, 2 - invalid arguments or snapshots.
+
+#include <vi_timing/vi_timing.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+using namespace std::literals;
+
+namespace
+{
+	constexpr int EXIT_REGRESSED = 1;
+	constexpr int EXIT_INVALID = 2;
+
+	std::optional<std::string> read_file(const char *path)
+	{	std::ifstream file{ path, std::ios::binary };
+		if (!file)
+		{	return std::nullopt;
+		}
+		std::ostringstream ss;
+		ss << file.rdbuf();
+		return std::move(ss).str();
+	}
+}
+
+int main(int argc, char **argv)
+{	const char *paths[2]{};
+	double threshold = 0.05;
+	bool valid = true;
+	for (int n = 1; n < argc && valid; ++n)
+	{	if ("-t"sv == argv[n] && n + 1 < argc)
+		{	char *end = nullptr;
+			threshold = std::strtod(argv[++n], &end);
+			valid = *end == '\0' && threshold >= 0.0;
+		}
+		else if ('-' != argv[n][0] && !paths[1])
+		{	(paths[0] ? paths[1] : paths[0]) = argv[n];
+		}
+		else
+		{	valid = false;
+		}
+	}
+
+	if (!valid || !paths[1])
+	{	std::fprintf(stderr, "Usage: %s <baseline.csv> <current.csv> [-t <threshold>]\n", argv[0]);
+		return EXIT_INVALID;
+	}
+
+	std::optional<std::string> text[2];
+	for (int n = 0; n < 2; ++n)
+	{	if (text[n] = read_file(paths[n]); !text[n])
+		{	std::fprintf(stderr, "%s: cannot read the file.\n", paths[n]);
+			return EXIT_INVALID;
+		}
+	}
+
+	const auto regressed = vi_tmSnapshotDiff(text[0]->c_str(), text[1]->c_str(), threshold);
+	if (VI_FAILED(regressed))
+	{	std::fprintf(stderr, "The snapshots are malformed: expected CSV exports of a registry.\n");
+		return EXIT_INVALID;
+	}
+	return 0 == regressed ? EXIT_SUCCESS : EXIT_REGRESSED;
+}
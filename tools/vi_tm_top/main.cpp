@@ -0,0 +1,245 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+/*****************************************************************************\
+* This file is part of the vi_timing library.
+*
+* vi_timing - a compact, lightweight C/C++ library for measuring code
+* execution time. It was developed for experimental and educational purposes,
+* so please keep expectations reasonable.
+*
+* Report bugs or suggest improvements to author: <programmer.amateur@proton.me>
+*
+* LICENSE & DISCLAIMER:
+* - No warranties. Use at your own risk.
+* - Licensed under Business Source License 1.1 (BSL-1.1):
+*   - Free for non-commercial use.
+*   - For commercial licensing, contact the author.
+*   - Change Date: 2029-09-01 - after which the library will be licensed
+*     under GNU GPLv3.
+*   - Attribution required: "vi_timing Library (c) A.Prograamar".
+*   - See LICENSE in the project root for full terms.
+\*****************************************************************************/
+
+// vi_tm_top - a 'top'-style viewer of the live statistics page (see vi_timing_shm.h).
+// Usage: vi_tm_top <name> [-i <interval ms>] [-n <number of samples>]
+// The page is created in the measured process by vi_tmRegistryMirror(hreg, "<name>").
+
+#include <vi_timing/vi_timing.hpp>
+#include <vi_timing/vi_timing_shm.h>
+
+#include <fcntl.h> // For O_RDONLY.
+#include <sys/mman.h> // For shm_open, mmap.
+#include <sys/stat.h> // For fstat.
+#include <unistd.h> // For close, isatty.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace std::literals;
+
+namespace
+{
+	struct entry_t
+	{	std::string name_;
+		vi_tmStats_t stats_; // The last consistent copy.
+		bool locked_ = false; // The last load failed: the slot stays locked, e.g. its writer died in the middle of an update.
+	};
+
+	struct row_t
+	{	const std::string *name_;
+		double calls_per_sec_;
+		double load_; // Measured seconds per second of wall time.
+		double average_; // Seconds per event.
+	};
+
+	class page_t
+	{	const vi_tmShmHeader_t *header_ = nullptr;
+		std::size_t size_ = 0U;
+	public:
+		page_t(const page_t &) = delete;
+		page_t &operator=(const page_t &) = delete;
+		explicit page_t(std::string name)
+		{	if (name.empty())
+			{	std::fputs("The page name is empty.\n", stderr);
+				return;
+			}
+			if ('/' != name.front())
+			{	name.insert(0, 1, '/');
+			}
+
+			const auto fd = shm_open(name.c_str(), O_RDONLY, 0);
+			if (fd < 0)
+			{	std::perror(name.c_str());
+				return;
+			}
+
+			struct stat st{};
+			if (0 == fstat(fd, &st) && static_cast<std::size_t>(st.st_size) >= sizeof(vi_tmShmHeader_t))
+			{	size_ = static_cast<std::size_t>(st.st_size);
+				if (auto addr = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0); MAP_FAILED != addr)
+				{	header_ = static_cast<const vi_tmShmHeader_t *>(addr);
+				}
+			}
+			close(fd);
+		}
+		~page_t()
+		{	if (header_)
+			{	munmap(const_cast<vi_tmShmHeader_t *>(header_), size_);
+			}
+		}
+
+		const char *validate() const
+		{	const auto flags = *static_cast<const unsigned *>(vi_tmStaticInfo(vi_tmInfoFlags));
+			if (!header_) return "The page is not mapped.";
+			if (VI_TM_SHM_MAGIC != header_->magic_) return "The page is not initialized.";
+			if (VI_TM_SHM_VERSION != header_->version_) return "Unsupported page version.";
+			if (sizeof(vi_tmShmSlot_t) != header_->slot_size_ ||
+				(VI_TM_SHM_LAYOUT_FLAGS & flags) != (VI_TM_SHM_LAYOUT_FLAGS & header_->flags_))
+				return "The writer was built with different statistics options.";
+			if (sizeof(vi_tmShmHeader_t) + header_->capacity_ * sizeof(vi_tmShmSlot_t) > size_) return "The page is truncated.";
+			return nullptr;
+		}
+
+		const vi_tmShmHeader_t &header() const noexcept { return *header_; }
+
+		void sample(std::vector<entry_t> &dst) const
+		{	const auto count = std::min(__atomic_load_n(&header_->count_, __ATOMIC_ACQUIRE), header_->capacity_);
+			const auto slots = reinterpret_cast<const vi_tmShmSlot_t *>(header_ + 1);
+			dst.resize(count);
+			for (std::uint32_t n = 0; n < count; ++n)
+			{	if (dst[n].name_.empty())
+				{	dst[n].name_ = slots[n].name_;
+				}
+				vi_tmStats_t stats;
+				dst[n].locked_ = VI_FAILED(vi_tmShmSlotLoad(&slots[n], &stats));
+				if (!dst[n].locked_)
+				{	dst[n].stats_ = stats;
+				}
+			}
+		}
+	};
+
+	// True if a counter of 'cur' is below the one of 'prev': the measurement was reset between the samples.
+	bool is_reset(const entry_t &prev, const entry_t &cur) noexcept
+	{	return cur.stats_.calls_ < prev.stats_.calls_
+#if VI_TM_STAT_USE_RAW
+			|| cur.stats_.cnt_ < prev.stats_.cnt_ || cur.stats_.sum_ < prev.stats_.sum_
+#endif
+#if VI_TM_STAT_USE_RMSE
+			|| cur.stats_.flt_cnt_ < prev.stats_.flt_cnt_
+#endif
+			;
+	}
+
+	// Rate of change of a measurement between two samples taken 'interval' seconds apart.
+	row_t make_row(const entry_t &prev, const entry_t &cur, const vi_tmShmHeader_t &h, double interval)
+	{	row_t result{ &cur.name_, 0.0, 0.0, 0.0 };
+		const auto calls = static_cast<double>(cur.stats_.calls_ - prev.stats_.calls_);
+		result.calls_per_sec_ = calls / interval;
+#if VI_TM_STAT_USE_RAW
+		const auto cnt = static_cast<double>(cur.stats_.cnt_ - prev.stats_.cnt_);
+		const auto ticks = static_cast<double>(cur.stats_.sum_ - prev.stats_.sum_) - h.overhead_ticks_ * calls;
+#elif VI_TM_STAT_USE_RMSE
+		const auto cnt = cur.stats_.flt_cnt_ - prev.stats_.flt_cnt_;
+		const auto ticks = cur.stats_.flt_avg_ * cur.stats_.flt_cnt_ - prev.stats_.flt_avg_ * prev.stats_.flt_cnt_ - h.overhead_ticks_ * calls;
+#else
+		const auto cnt = 0.0;
+		const auto ticks = 0.0;
+#endif
+		if (ticks > 0.0)
+		{	result.load_ = ticks * h.seconds_per_tick_ / interval;
+			result.average_ = cnt > 0.0 ? ticks * h.seconds_per_tick_ / cnt : 0.0;
+		}
+		return result;
+	}
+
+	void print(const std::vector<entry_t> &prev, const std::vector<entry_t> &cur, const vi_tmShmHeader_t &h, double interval, bool clear)
+	{	std::vector<row_t> rows;
+		rows.reserve(cur.size());
+		for (std::size_t n = 0; n < cur.size(); ++n)
+		{	if (cur[n].locked_ || (n < prev.size() && prev[n].locked_))
+			{	continue; // No consistent pair of samples: the slot is skipped.
+			}
+			static const entry_t zero = [] { entry_t e; vi_tmStatsReset(&e.stats_); return e; }();
+			const auto &base = (n < prev.size() && !is_reset(prev[n], cur[n])) ? prev[n] : zero; // After a reset, the counters start from zero.
+			rows.push_back(make_row(base, cur[n], h, interval));
+		}
+		std::sort(rows.begin(), rows.end(), [](const row_t &l, const row_t &r) { return l.load_ > r.load_; });
+
+		if (clear)
+		{	std::fputs("\x1B[H\x1B[2J", stdout);
+		}
+		std::printf("vi_tm_top: pid %u, %zu of %u slots, interval %ss\n", h.pid_, cur.size(), h.capacity_, vi_tm::to_string(interval).c_str());
+		if (const auto skipped = cur.size() - rows.size())
+		{	std::printf("%zu locked slot(s) skipped\n", skipped);
+		}
+		std::printf("%10s %8s %10s  %s\n", "Calls/s", "Load", "Avg.", "Name");
+		for (const auto &r : rows)
+		{	std::printf
+			(	"%10s %7.1f%% %9ss  %s\n",
+				vi_tm::to_string(r.calls_per_sec_).c_str(),
+				r.load_ * 100.0,
+				vi_tm::to_string(r.average_).c_str(),
+				r.name_->c_str()
+			);
+		}
+		std::fflush(stdout);
+	}
+}
+
+int main(int argc, char **argv)
+{	const char *name = nullptr;
+	unsigned interval_ms = 1'000U;
+	unsigned count = 0U; // Zero - until interrupted.
+	for (int n = 1; n < argc; ++n)
+	{	if ("-i"sv == argv[n] && n + 1 < argc)
+		{	interval_ms = static_cast<unsigned>(std::strtoul(argv[++n], nullptr, 10));
+		}
+		else if ("-n"sv == argv[n] && n + 1 < argc)
+		{	count = static_cast<unsigned>(std::strtoul(argv[++n], nullptr, 10));
+		}
+		else if (!name && '-' != argv[n][0])
+		{	name = argv[n];
+		}
+		else
+		{	name = nullptr;
+			break;
+		}
+	}
+
+	if (!name || 0U == interval_ms)
+	{	std::fprintf(stderr, "Usage: %s <name> [-i <interval ms>] [-n <number of samples>]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	const page_t page{ name };
+	if (const auto err = page.validate())
+	{	std::fprintf(stderr, "%s: %s\n", name, err);
+		return EXIT_FAILURE;
+	}
+
+	const bool clear = (0U == count) && isatty(STDOUT_FILENO);
+	std::vector<entry_t> prev;
+	std::vector<entry_t> cur;
+	page.sample(prev);
+	auto last = std::chrono::steady_clock::now();
+	for (unsigned n = 0U; 0U == count || n < count; ++n)
+	{	std::this_thread::sleep_for(std::chrono::milliseconds{ interval_ms });
+		cur = prev;
+		page.sample(cur);
+		const auto now = std::chrono::steady_clock::now();
+		print(prev, cur, page.header(), std::chrono::duration<double>(now - last).count(), clear);
+		last = now;
+		std::swap(prev, cur);
+	}
+
+	return EXIT_SUCCESS;
+}